@@ -2,13 +2,19 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <assert.h>
 #include <string.h>
 #include <time.h>
-
-//Definimos los infinitos (los valores menor y mayor posibles con el tipo INT)
-#define INF_P "9223372036854775808"
-#define INF_N "-9223372036854775808"
+#include <pthread.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 //El presente programa consta de la implementación de estructuras híbridas entre un heap y una tabla hash
 //NOTA 1: El tipo size_t facilita el trabajo con variables que solo almacenan valores enteros positivos
@@ -22,7 +28,7 @@
 #define NOTVALID 0
 #define DELETED NOTVALID
 #define LAZY_DELETED -1
-#define MAX_64 2147483647
+#define MAX_64 9223372036854775807
 #define FULL 2
 #define EMPTY 1
 #define UP 1
@@ -30,19 +36,46 @@
 #define LP 1
 #define QP 2
 #define DH 3
+#define RH 4                        //Robin Hood (sondeo lineal con borrado por corrimiento hacia atrás)
+#define SW 5                        //Tabla "suiza": bytes de control por casilla revisados de 16 en 16
+#define DIRTY 3                     //Tabla con demasiadas marcas de borrado: se reacomoda sin cambiar de tamaño
+#define H_ADLER 1
+#define H_WY 2
+#define MIGRATE_STEP 8              //Casillas de la tabla anterior que se migran en cada operación (modo incremental)
+
+//Bits de la llave hash que se guarda en cada casilla. Se elige al compilar: gcc -DHASH_BITS=64 ... (32 por defecto)
+//NOTA: Con 32 bits la tabla no pasa de 2^32 casillas (las llaves no alcanzan más casillas iniciales). Con 64 bits
+//... llega hasta 2^40, pero los datos de sondeo de cada casilla ocupan 16 bytes en vez de 8
+#ifndef HASH_BITS
+#define HASH_BITS 32
+#endif
+#if HASH_BITS == 64
+typedef uint64_t hash_t;
+#elif HASH_BITS == 32
+typedef uint32_t hash_t;
+#else
+#error "HASH_BITS debe ser 32 o 64"
+#endif
 
-//En este arreglo se contienen los números primos menores a potencias de 2 (hasta 2^16)
-const uint32_t HASH_SIZE[] = {23, 127, 251, 509, 1021, 2039, 4093, 8191, 16381, 32749, 65521, 131071, 262139, 524287, 1048573, 2097143, 4194301, 8388593, 16777213, 33554393, 67108859, 134217689, 268435399, 536870909, 1073741789, 2147483647, 4294967291};
+//En este arreglo se contienen los números primos menores a potencias de 2 (hasta 2^32, o 2^40 con HASH_BITS=64)
+const uint64_t HASH_SIZE[] = {23, 127, 251, 509, 1021, 2039, 4093, 8191, 16381, 32749, 65521, 131071, 262139, 524287, 1048573, 2097143, 4194301, 8388593, 16777213, 33554393, 67108859, 134217689, 268435399, 536870909, 1073741789, 2147483647, 4294967291
+#if HASH_BITS == 64
+    , 8589934583, 17179869143, 34359738337, 68719476731, 137438953447, 274877906899, 549755813881, 1099511627689
+#endif
+};
+#define TABLE_SIZES (sizeof(HASH_SIZE)/sizeof(HASH_SIZE[0]))
+//Con la opción "pow2" los tamaños son potencias de dos (2^5, 2^6, ..., 2^POW2_MAX_BITS): la casilla se obtiene con
+//... una máscara en vez de un módulo (ver hashFunction)
+#define POW2_MIN_BITS 5
+#if HASH_BITS == 64
+#define POW2_MAX_BITS 40
+#else
+#define POW2_MAX_BITS 32
+#endif
 
 //Constante de ADLER
 const uint32_t MOD_ADLER = 65521;
 
-//Variable Global para la histéresis
-int hist = 0;
-
-//Variable global para guardar la multiplicidad de un elemento del Heap e imprimirlo (se cambiará su valor cada...
-//... vez que se imprima un elemento de heap)
-size_t multiplicidad = 0; 
 
 /*Función generadora de llaves*/
 uint32_t adler32(unsigned char *data, size_t len) {
@@ -57,100 +90,856 @@ uint32_t adler32(unsigned char *data, size_t len) {
     return (b << 16) | a; //Aquí se recorre b 16 bits a la izquierda y después cada bit de b se opera OR con el respectivo bit de a
 }
 
+/*Constantes del mezclador de 64 bits (familia wyhash)*/
+const uint64_t WY_P0 = 0xa0761d6478bd642full;
+const uint64_t WY_P1 = 0xe7037ed1a0b428dbull;
+const uint64_t WY_P2 = 0x8ebc6af09c88c6e3ull;
+
+/*Multiplicación de 64x64 bits a 128 y plegado de ambas mitades (XOR)*/
+static inline uint64_t wymix(uint64_t a, uint64_t b){
+    __uint128_t r = (__uint128_t)a * b;
+    return (uint64_t)r ^ (uint64_t)(r >> 64);
+}
+
+/*Lecturas sin alinear de 8, 4 y hasta 3 bytes*/
+static inline uint64_t wyr8(const unsigned char *p){
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+static inline uint64_t wyr4(const unsigned char *p){
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+static inline uint64_t wyr3(const unsigned char *p, size_t k){
+    return (((uint64_t)p[0]) << 16) | (((uint64_t)p[k >> 1]) << 8) | p[k - 1];
+}
+
+/*Función generadora de llaves de 64 bits (estilo wyhash): procesa 16 bytes por vuelta sin ninguna división*/
+uint64_t wyhash64(const unsigned char *data, size_t len){
+    const unsigned char *p = data;
+    uint64_t seed = wymix(WY_P0, WY_P2);
+    uint64_t a, b;
+    if(len <= 16){
+        if(len >= 4){
+            a = (wyr4(p) << 32) | wyr4(p + ((len >> 3) << 2));
+            b = (wyr4(p + len - 4) << 32) | wyr4(p + len - 4 - ((len >> 3) << 2));
+        }
+        else if(len > 0){
+            a = wyr3(p, len);
+            b = 0;
+        }
+        else
+            a = b = 0;
+    }
+    else{
+        size_t i = len;
+        while(i > 16){
+            seed = wymix(wyr8(p) ^ WY_P1, wyr8(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        a = wyr8(p + i - 16);
+        b = wyr8(p + i - 8);
+    }
+    //Última mezcla: se multiplican ambas mitades y se pliega el resultado junto con la longitud
+    __uint128_t r = (__uint128_t)(a ^ WY_P1) * (b ^ seed);
+    return wymix((uint64_t)r ^ WY_P0 ^ len, (uint64_t)(r >> 64) ^ WY_P1);
+}
+
 /*Estructura tipo record para incluir la longitud de cadena y los bytes de una información (como un stream de datos, con un puntero al inicio y de ahí sabemos la longitud)*/
 typedef struct{
     void *bytes;                //El "void" es para que podamos decir que es un puntero de cualquier tipo de datos
     size_t len;                 //Longitud del contenido
 }record;
 
+/*Páginas grandes para los arreglos de la tabla y del heap (se elige al crear el quash, ver HTconfig)*/
+//NOTA: Con millones de casillas cada búsqueda cae en una página distinta y se pierde más tiempo en fallos de la TLB
+//... que en leer la casilla. Con páginas de 2 MB una misma entrada de la TLB cubre 512 veces más memoria
+#define HUGE_OFF 0                  //malloc, como cualquier otro bloque
+#define HUGE_THP 1                  //mmap anónimo alineado a 2 MB + madvise(MADV_HUGEPAGE) (páginas grandes transparentes)
+#define HUGE_EXPLICIT 2             //mmap con MAP_HUGETLB (páginas reservadas en /proc/sys/vm/nr_hugepages); si no hay, THP
+#define HUGE_PAGE ((size_t)2 << 20)
+
+/*YES si un bloque de "len" bytes se reserva con páginas grandes (los menores a una página grande van con malloc)*/
+//NOTA: Sólo depende del largo y de la opción, así que al soltar el bloque se sabe cómo se reservó
+static inline int hugeBlock(size_t len, int huge){
+    return huge != HUGE_OFF && len >= HUGE_PAGE;
+}
+
+/*Largo de un bloque con páginas grandes (múltiplo de HUGE_PAGE)*/
+static inline size_t hugeLength(size_t len){
+    return (len + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+}
+
+/*Reserva un bloque de "len" bytes (en ceros si "zero" es YES). Regresa NULL si no hay memoria*/
+void* allocBlock(size_t len, int huge, int zero){
+    if(!hugeBlock(len, huge))
+        return zero ? calloc(1, len) : malloc(len);
+    size_t length = hugeLength(len);
+#ifdef MAP_HUGETLB
+    if(huge == HUGE_EXPLICIT){
+        void *block = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if(block != MAP_FAILED)
+            return block;
+    }
+#endif
+    //Se mapea una página grande de más para poder recortar el bloque a una dirección alineada (el kernel sólo usa
+    //... páginas grandes en tramos alineados a 2 MB)
+    unsigned char *raw = (unsigned char*)mmap(NULL, length + HUGE_PAGE, PROT_READ | PROT_WRITE,
+                                              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(raw == MAP_FAILED)
+        return NULL;
+    unsigned char *block = (unsigned char*)(((uintptr_t)raw + HUGE_PAGE - 1) & ~(uintptr_t)(HUGE_PAGE - 1));
+    if(block > raw)
+        munmap(raw, block - raw);
+    if(block + length < raw + length + HUGE_PAGE)
+        munmap(block + length, raw + length + HUGE_PAGE - (block + length));
+#ifdef MADV_HUGEPAGE
+    madvise(block, length, MADV_HUGEPAGE);
+#endif
+    //Las páginas de un mapeo anónimo ya están en ceros
+    return block;
+}
+
+/*Bloques de memoria: se reservan con allocBlock o vienen de un snapshot mapeado con mmap (ver SNAPSHOTS)*/
+//NOTA: Cada sección del snapshot empieza en su propia página, así que se puede soltar con munmap por separado
+static inline void releaseBlock(void *block, size_t len, int mapped, int huge){
+    if(block == NULL)
+        return;
+    if(mapped){
+        if(len > 0)
+            munmap(block, len);
+        return;
+    }
+    if(hugeBlock(len, huge))
+        munmap(block, hugeLength(len));
+    else
+        free(block);
+}
+
+/*Agranda un bloque a "new_len" bytes. Si estaba mapeado, se copia a memoria propia (y ya no lo está)*/
+//NOTA: Un bloque con páginas grandes no se puede agrandar con realloc: se reserva otro y se copia
+static inline void* growBlock(void *block, size_t len, size_t new_len, int *mapped, int huge){
+    if(!*mapped && !hugeBlock(len, huge) && !hugeBlock(new_len, huge))
+        return realloc(block, new_len);
+    void *copy = allocBlock(new_len, huge, NO);
+    if(copy == NULL)
+        return NULL;
+    memcpy(copy, block, len);
+    releaseBlock(block, len, *mapped, huge);
+    *mapped = NO;
+    return copy;
+}
+
+/*Almacén único de llaves (arena) que comparten la tabla hash y el heap*/
+//Cada llave se copia una sola vez a un bloque contiguo; la tabla y el heap sólo guardan un "ref" de 64 bits con el
+//desplazamiento dentro del bloque (40 bits) y la longitud (24 bits). Como es un desplazamiento y no un puntero,
+//el ref sigue siendo válido aunque el bloque se mueva al crecer con realloc
+#define REF_LEN_BITS 24
+#define REF_MAX_LEN ((1u << REF_LEN_BITS) - 1)
+typedef struct{
+    unsigned char *bytes;       //Bloque con los bytes de todas las llaves
+    size_t used;                //Bytes ocupados (incluye los de llaves ya borradas)
+    size_t cap;                 //Capacidad del bloque
+    size_t dead;                //Bytes de llaves borradas (se recuperan al compactar durante un remodelado)
+    int mapped;                 //YES si el bloque es parte de un snapshot mapeado
+}key_arena;
+
+static inline uint64_t makeRef(size_t offset, size_t len){
+    return ((uint64_t)offset << REF_LEN_BITS) | len;
+}
+static inline size_t refOffset(uint64_t ref){
+    return ref >> REF_LEN_BITS;
+}
+static inline size_t refLen(uint64_t ref){
+    return ref & REF_MAX_LEN;
+}
+
+//Capacidad mínima de una arena (también la de la primera vez que crece una arena restaurada sin llaves)
+#define ARENA_MIN_CAP 64
+
+/*Inicializa una arena vacía con espacio para "cap" bytes*/
+void initArena(key_arena *A, size_t cap){
+    if(cap < ARENA_MIN_CAP)
+        cap = ARENA_MIN_CAP;
+    A->bytes = (unsigned char*)malloc(cap);
+    if(A->bytes == NULL){
+        fprintf(stderr, "Cannot allocate memory for keys.");
+        exit(1);
+    }
+    A->used = 0;
+    A->cap = cap;
+    A->dead = 0;
+    A->mapped = NO;
+}
+
+/*Copia una llave al final de la arena y escribe su ref. Regresa NO si no hay memoria o la llave es demasiado larga*/
+int arenaIntern(key_arena *A, record *rec, uint64_t *ref){
+    if(rec->len > REF_MAX_LEN)
+        return NO;
+    if(A->used + rec->len > A->cap){
+        size_t cap = A->cap < ARENA_MIN_CAP ? ARENA_MIN_CAP : A->cap*2;
+        while(A->used + rec->len > cap)
+            cap *= 2;
+        unsigned char *bytes = (unsigned char*)growBlock(A->bytes, A->used, cap, &A->mapped, HUGE_OFF);
+        if(bytes == NULL)
+            return NO;
+        A->bytes = bytes;
+        A->cap = cap;
+    }
+    memcpy(A->bytes + A->used, rec->bytes, rec->len);
+    *ref = makeRef(A->used, rec->len);
+    A->used += rec->len;
+    return YES;
+}
+
+/*Regresa un record que apunta a los bytes de una llave de la arena*/
+//OJO: deja de ser válido si después se agrega otra llave a la arena (el bloque puede moverse)
+static inline record arenaView(key_arena *A, uint64_t ref){
+    record rec;
+    rec.bytes = A->bytes + refOffset(ref);
+    rec.len = refLen(ref);
+    return rec;
+}
+
+/*Marca como basura los bytes de una llave borrada (la memoria se libera toda junta)*/
+static inline void arenaRelease(key_arena *A, uint64_t ref){
+    A->dead += refLen(ref);
+}
+
+/*Libera de una sola vez todas las llaves*/
+void freeArena(key_arena *A){
+    releaseBlock(A->bytes, A->cap, A->mapped, HUGE_OFF);
+    A->bytes = NULL;
+    A->used = A->cap = A->dead = 0;
+    A->mapped = NO;
+}
+
 /****************************************HEAP******************************************************************/
+//Aridad del heap (hijos por nodo). Se elige al compilar: gcc -DHEAP_ARITY=4 ... (2 por defecto)
+//NOTA: Los hijos de un nodo quedan juntos en el arreglo, así que con 4 u 8 hijos se comparan en una sola pasada por
+//... memoria contigua y el árbol tiene la mitad (o la tercera parte) de niveles
+#ifndef HEAP_ARITY
+#define HEAP_ARITY 2
+#endif
+#if HEAP_ARITY != 2 && HEAP_ARITY != 4 && HEAP_ARITY != 8
+#error "HEAP_ARITY debe ser 2, 4 u 8"
+#endif
+
 /*Estructura de un elemento (nodo) del heap*/
 typedef struct {
-    record rec;                 //Contenido a guardar en la posición del heap
+    union{
+        uint64_t ref;           //Ref de la llave en la arena del quash (compartida con la tabla hash)
+        int64_t num;            //Llave ya convertida a entero (sólo en modo numérico, no se usa la arena)
+    };
     size_t mult;                //Contador de multiplicidad
     size_t hash_index;          //Índice de la tabla hash donde se encuentra el elemento
 } heap_item;
 
+//Motores de prioridad del quash (se elige al crearlo, ver HTconfig)
+#define ENGINE_HEAP 0               //Heap de aridad HEAP_ARITY acomodado por comparaciones (cualquier orden de llaves)
+#define ENGINE_RADIX 1              //Radix heap: sólo modo numérico; pensado para mínimos extraídos que nunca decrecen
+
+//NOTA: Con el motor radix los nodos no forman un árbol: siguen en "array" (la tabla los apunta igual, por heap_index),
+//... pero cada uno pertenece a una cubeta según el bit más alto en que su llave difiere de "last", el último mínimo
+//... extraído (cubeta 0 si es igual, b+1 si el bit más alto distinto es b). Para sacar el mínimo se toma la primera
+//... cubeta con nodos y se reparten sus nodos en cubetas menores: cada nodo baja de cubeta a lo más 64 veces
+#define RADIX_BUCKETS 65
+#define RADIX_POS_BITS 56           //radix_link: cubeta en los 8 bits altos y posición dentro de ella en el resto
+
+/*Cubeta del motor radix: posiciones (en "array") de sus nodos, sin orden*/
+typedef struct {
+    size_t *nodes;
+    size_t len, cap;
+} radix_bucket;
+
 /*Estructura del tipo heap*/
 typedef struct {
     heap_item *array;           //Primera dirección del arreglo de nodos
     size_t cap;                 //Longitud del arreglo que representa al árbol (capacidad de número de nodos)
     size_t index;               //Índice del último nodo válido 
+    int numeric;                //YES si los nodos se comparan por "num" (int64_t) y no por los dígitos de la llave
+    key_arena *keys;            //Arena con los bytes de las llaves (pertenece a la tabla hash)
+    int mapped;                 //YES si "array" es parte de un snapshot mapeado
+    int huge;                   //Páginas grandes para "array" (la opción "huge" del quash)
+    int engine;                 //ENGINE_HEAP o ENGINE_RADIX
+    //Motor radix (sólo con ENGINE_RADIX)
+    uint64_t last;              //Último mínimo extraído (llave sin signo, ver radixKey); ninguna llave es menor
+    uint64_t occupied;          //El bit b está encendido si la cubeta b+1 tiene nodos
+    radix_bucket bucket[RADIX_BUCKETS];
+    uint64_t *link;             //Cubeta y posición en ella de cada nodo (paralelo a "array", con la misma capacidad)
 } heap;
 
 /*Algunos prototipos de funciones de heap*/
-heap* newHeapCap(size_t cap);
-heap* newHeap();
+heap* newHeapCap(size_t cap, int numeric, int huge, int engine, key_arena *keys);
+heap* newHeap(int numeric, int huge, int engine, key_arena *keys);
 void freeHeap(heap *h);
 /**************************************************************************************************************/
 
-/*Tipo de estructura de un elemento de tabla hash... pero añadiendo su localización en el heap correspondiente*/
+//NOTA: Cada casilla de la tabla se divide en dos arreglos paralelos (mismo índice). Los sondeos recorren sólo el de
+//... datos de sondeo (8 bytes por casilla, 16 con HASH_BITS=64) y leen el elemento únicamente cuando coincide la llave hash
+
+/*Datos de sondeo de una casilla de la tabla hash*/
 typedef struct {
-    record rec;                 //Contenido a guardar en la posición de la tabla
-    size_t len;                 //Longitud en bytes del record
+    hash_t key;                 //La llave del contenido
     char status;                //Estado del item (ponemos si está libre, si está sucio, etc...)
     char lazy_deleted;          //Bandera para indicar si hubo o no un elemento borrado en esa posición
     char leapt;                 //Bandera para indicar que un elemento fue "saltado" durante un proceso de búsqueda de lugar disponible
+} hash_meta;
+
+/*Tipo de estructura de un elemento de tabla hash... pero añadiendo su localización en el heap correspondiente*/
+typedef struct {
+    union{
+        uint64_t ref;           //Ref de la llave en la arena del quash
+        int64_t num;            //Llave misma en modo numérico
+    };
     size_t heap_index;          //Ubicación del elemento en el heap
-    uint32_t key;               //La llave del contenido
 } hash_item;                    //Nombre
 
+/*Opciones con las que se crea un quash (se conservan cada vez que se remodela)*/
+typedef struct{
+    int hash_type;              //Familia de la función hash (H_ADLER o H_WY)
+    int numeric;                //YES si las llaves son enteros de 64 bits: el record guarda los 8 bytes del int64_t
+    int incremental;            //YES si los remodelados migran la tabla poco a poco (sin pausas largas)
+    int probing;                //Tipo de sondeo de la tabla (LP, QP, DH, RH o SW)
+    int output;                 //Qué imprime el intérprete (OUT_VERBOSE, OUT_QUIET u OUT_SUMMARY)
+    int pow2;                   //YES si los tamaños de la tabla son potencias de dos (si no, los primos de HASH_SIZE)
+    //Política de carga (0 = la de siempre: 50% de carga máxima, o 7/8 con SW; reducir bajo el 10%; histéresis de 1)
+    int max_load;               //Porcentaje de carga con el que crece la tabla
+    int min_load;               //Porcentaje de carga bajo el que se reduce (más la histéresis "hist")
+    int hysteresis;             //Lo que sube "hist" con cada reducción (-1 = sin histéresis)
+    int huge;                   //Páginas grandes para la tabla y el heap (HUGE_OFF, HUGE_THP o HUGE_EXPLICIT)
+    int engine;                 //Motor de prioridad (ENGINE_HEAP o ENGINE_RADIX, que requiere el modo numérico)
+} HTconfig;
+
+/*Modos de salida del intérprete*/
+#define OUT_VERBOSE 0           //Un mensaje por operación (por defecto)
+#define OUT_QUIET 1             //Sólo se cuentan los resultados
+#define OUT_SUMMARY 2           //Se cuentan y se imprime el resumen al salir
+#define OUT_BUFFER (1 << 16)    //Bytes que se juntan antes de escribir con fwrite
+
+/*Cantidad de resultados de cada tipo (se cuentan en todos los modos)*/
+typedef struct {
+    size_t inserted, repeated;                  //insert: llave nueva / ya estaba
+    size_t deleted, decremented, absent;        //delete: eliminada / decrementada / no presente
+    size_t found, not_found;                    //lookup
+    size_t min_deleted, min_decremented, min_empty;     //deleteMin (cada llave de un "deleteMin k" cuenta)
+    size_t updated, update_absent;              //update
+} out_counts;
+
+/*Journal (bitácora) de las operaciones que modifican el quash (ver JOURNAL)*/
+typedef struct {
+    int fd;                     //Archivo del journal (-1 si no hay journal)
+    unsigned char *bytes;       //Operaciones del grupo que todavía no se escriben
+    size_t used, cap;
+    size_t ops;                 //Operaciones en el grupo pendiente
+    size_t group;               //Operaciones por grupo (al juntarse se escriben y se hace un solo fdatasync)
+    long interval;              //Espera máxima (ns) de una operación antes de su fdatasync
+    struct timespec first;      //Momento en que entró la primera operación del grupo
+    int replay;                 //YES mientras se reproduce (un archivo que ya no está o cambió es un error fatal)
+    char *path;                 //Ruta del journal (para reemplazarlo completo después de un snapshot)
+} journal;
+
+/*Salida del intérprete: los mensajes se juntan en un buffer propio de cada quash*/
+typedef struct {
+    char *bytes;                //Buffer (se reserva con el primer mensaje)
+    size_t used;
+    out_counts count;
+    journal *wal;               //Journal del quash: su grupo pendiente se escribe antes que cualquier respuesta
+} out_buffer;
+
+/*Contadores de la estructura (se actualizan siempre: cada uno cuesta una suma por operación o por remodelado)*/
+#define PROBE_BUCKETS 16        //Histograma de colisiones: 0, 1, ..., 14 y 15 o más
+typedef struct {
+    size_t find_probes[PROBE_BUCKETS];      //Búsquedas con DHFindKey según sus colisiones
+    size_t insert_probes[PROBE_BUCKETS];    //Lugares buscados con DoubleHashing según sus colisiones
+    size_t remodels;                        //Remodelados de la tabla (crecer, reducir o limpiar)
+    uint64_t remodel_ns;                    //Tiempo total en ellos
+    size_t heap_grows;                      //Veces que se duplicó el arreglo del heap (RemodelHeap)
+    uint64_t heap_grow_ns;
+    size_t swaps_up, swaps_down;            //Intercambios de heapifyUp y heapifyDown
+    size_t compactions;                     //Compactaciones de la arena (cambian los refs de las llaves)
+    size_t radix_moves;                     //Nodos que el motor radix pasó a una cubeta menor
+    size_t radix_rebuilds;                  //Veces que una llave menor a "last" obligó a repartir todas las cubetas
+} quash_stats;
+
+/*Reloj de las estadísticas (ns)*/
+static inline uint64_t statsClock(void){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec*1000000000ull + t.tv_nsec;
+}
+
+/*Suma una búsqueda o inserción con "i" colisiones a su histograma*/
+static inline void countProbes(size_t *histogram, size_t i){
+    histogram[i < PROBE_BUCKETS - 1 ? i : PROBE_BUCKETS - 1]++;
+}
+
 /*Estructura de la tabla hash con el link agregado hacia el heap (es decir, este es el quash)*/
 typedef struct{
     hash_item *table;           //Dirección del primer elemento en el arreglo de las cabezas
+    hash_meta *meta;            //Datos de sondeo de cada casilla (paralelo a "table")
     size_t index_size;          //Índice del tipo de capacidad (arreglo de diferentes tamaños con números impares)
     size_t size;                //Tamaño del arreglo
     size_t occupied_elements;   //Cantidad de elementos ocupados en la tabla
     heap *h;                    //Link al heap
+    key_arena keys;             //Única copia de las llaves (el heap y la tabla guardan sólo su ref)
+    HTconfig cfg;               //Opciones elegidas al crear la tabla (familia hash, modo numérico, incremental)
+    //Migración incremental: mientras dura, la tabla anterior convive con la nueva y las búsquedas revisan ambas
+    hash_item *old_table;       //Tabla anterior (NULL si no hay una migración en curso)
+    hash_meta *old_meta;        //Datos de sondeo de la tabla anterior
+    size_t old_size;            //Tamaño de la tabla anterior
+    size_t old_index_size;      //Índice de tamaño de la tabla anterior
+    size_t migrate_pos;         //Siguiente casilla de la tabla anterior por migrar
+    size_t tag;                 //Marca (0 o 1) de la tabla actual; cambia con cada migración
+    //Sondeo SW: un byte de control por casilla (sólo se reserva con ese sondeo)
+    uint8_t *ctrl;              //Bytes de control de la tabla actual
+    uint8_t *old_ctrl;          //Bytes de control de la tabla anterior (durante una migración)
+    size_t tombstones;          //Casillas de la tabla actual marcadas como borradas en "ctrl"
+    int hist;                   //Histéresis para reducir la tabla (crece con cada reducción)
+    int mapped;                 //YES si "table", "meta" y "ctrl" son parte de un snapshot mapeado
+    int old_mapped;             //Lo mismo para la tabla anterior (durante una migración)
+    out_buffer out;             //Salida de los mensajes del intérprete
+    journal wal;                //Journal de las operaciones (sólo lo usa el intérprete)
+    quash_stats stats;          //Contadores para el comando "stats"
 }HTable_OA;
 
+void journalCommit(journal *J);
+
+/*Función para escribir lo que haya en el buffer de salida*/
+//NOTA: Antes de mandar una respuesta, la operación que la produjo debe estar en el disco: primero se escribe el grupo
+//... pendiente del journal (si no hay journal, journalCommit no hace nada). Lo mismo cuando outWrite vacía el buffer
+void outFlush(out_buffer *out){
+    journalCommit(out->wal);
+    if(out->used > 0)
+        fwrite(out->bytes, 1, out->used, stdout);
+    out->used = 0;
+    fflush(stdout);
+}
+
+/*Función para agregar bytes al buffer de salida (si no caben, primero se escribe lo que había)*/
+static inline void outWrite(out_buffer *out, const void *bytes, size_t len){
+    if(out->bytes == NULL){
+        out->bytes = (char*)malloc(OUT_BUFFER);
+        if(out->bytes == NULL){
+            fprintf(stderr, "Error en malloc!\n");
+            exit(1);
+        }
+    }
+    if(out->used + len > OUT_BUFFER){
+        journalCommit(out->wal);
+        fwrite(out->bytes, 1, out->used, stdout);
+        out->used = 0;
+        //Un mensaje más grande que el buffer se escribe directo
+        if(len > OUT_BUFFER){
+            fwrite(bytes, 1, len, stdout);
+            return;
+        }
+    }
+    memcpy(out->bytes + out->used, bytes, len);
+    out->used += len;
+}
+
+static inline void outText(out_buffer *out, const char *text){
+    outWrite(out, text, strlen(text));
+}
+
+/*Entero sin signo en decimal (sin printf)*/
+static inline void outUInt(out_buffer *out, uint64_t value){
+    char digits[20];
+    size_t n = 0;
+    do{
+        digits[sizeof(digits) - ++n] = '0' + value%10;
+        value /= 10;
+    }while(value > 0);
+    outWrite(out, digits + sizeof(digits) - n, n);
+}
+
+static inline void outInt(out_buffer *out, int64_t value){
+    if(value < 0){
+        outWrite(out, "-", 1);
+        outUInt(out, -(uint64_t)value);
+        return;
+    }
+    outUInt(out, value);
+}
+
+/*Función para escribir el resumen de resultados (modo OUT_SUMMARY), una línea por comando*/
+void outSummary(out_buffer *out){
+    const out_counts *c = &out->count;
+    const char *names[] = {"insert: nuevos = ", ", repetidos = ", "\ndelete: eliminados = ", ", decrementados = ",
+                           ", no presentes = ", "\nlookup: encontrados = ", ", no encontrados = ",
+                           "\ndeleteMin: eliminados = ", ", decrementados = ", ", tabla vacia = ",
+                           "\nupdate: actualizados = ", ", no presentes = "};
+    const size_t values[] = {c->inserted, c->repeated, c->deleted, c->decremented, c->absent, c->found,
+                             c->not_found, c->min_deleted, c->min_decremented, c->min_empty, c->updated,
+                             c->update_absent};
+    for(size_t i=0; i<sizeof(values)/sizeof(values[0]); i++){
+        outText(out, names[i]);
+        outUInt(out, values[i]);
+    }
+    outWrite(out, "\n", 1);
+}
+
+/****************************************JOURNAL******************************************************************/
+//NOTA: Cada operación que modifica el quash se agrega al journal en el mismo formato del protocolo binario ("-b"):
+//... [código][largo (2 bytes, little endian)][llave] (y la segunda llave de "update"). Las operaciones se juntan en
+//... memoria y se escriben por grupos con un solo fdatasync (group commit), cuando el grupo llega a "group"
+//... operaciones, cuando la primera lleva "interval" esperando, o antes de que el intérprete espere más entrada
+//NOTA 2: Como es el mismo formato, el journal también se puede reproducir a mano con "quash -b < journal"
+//NOTA 3: Las operaciones que leen un archivo no guardan sólo su ruta (el archivo puede cambiar o desaparecer antes de
+//... reproducirlas): "load" se guarda como un insert por cada llave cargada y "restore" como OP_RESTORE_SUM, con la
+//... suma de los bytes del snapshot, que se verifica al reproducirlo
+
+/*Códigos de operación (son también los del protocolo binario)*/
+#define OP_NONE 0
+#define OP_INSERT 1
+#define OP_DELETE 2
+#define OP_LOOKUP 3
+#define OP_DELETEMIN 4
+#define OP_PRINT 5
+#define OP_UPDATE 6
+#define OP_LOAD 7
+#define OP_STOP 8
+#define OP_EXIT 9
+#define OP_SNAPSHOT 10
+#define OP_RESTORE 11
+#define OP_STATS 12
+#define OP_RESTORE_SUM 13       //"restore" con la suma del snapshot como segunda llave (lo escribe el journal)
+
+#define JOURNAL_GROUP 16384         //Operaciones por grupo (por defecto)
+#define JOURNAL_INTERVAL 10         //Milisegundos que puede esperar una operación su fdatasync (por defecto)
+#define JOURNAL_MAX_KEY 0xFFFF      //Largo máximo de una llave en el formato binario
+
+/*Journal desactivado*/
+void initJournal(journal *J){
+    memset(J, 0, sizeof(journal));
+    J->fd = -1;
+    J->group = JOURNAL_GROUP;
+    J->interval = JOURNAL_INTERVAL*1000000L;
+}
+
+/*Escribe "len" bytes completos en "fd". Regresa NO si no se pudo*/
+static int writeAll(int fd, const unsigned char *bytes, size_t len){
+    size_t done = 0;
+    while(done < len){
+        ssize_t put = write(fd, bytes + done, len - done);
+        if(put < 0 && errno == EINTR)
+            continue;
+        if(put <= 0)
+            return NO;
+        done += put;
+    }
+    return YES;
+}
+
+/*Función para escribir el grupo pendiente y esperar a que quede en el disco*/
+void journalCommit(journal *J){
+    if(J == NULL || J->fd < 0 || J->used == 0)
+        return;
+    if(writeAll(J->fd, J->bytes, J->used) == NO){
+        fprintf(stderr, "No se pudo escribir el journal\n");
+        exit(1);
+    }
+    if(fdatasync(J->fd) != 0){
+        fprintf(stderr, "No se pudo escribir el journal\n");
+        exit(1);
+    }
+    J->used = 0;
+    J->ops = 0;
+}
+
+/*Agrega los bytes de una llave con su largo*/
+static inline void journalKey(journal *J, record *rec){
+    J->bytes[J->used] = rec->len & 0xFF;
+    J->bytes[J->used + 1] = rec->len >> 8;
+    memcpy(J->bytes + J->used + 2, rec->bytes, rec->len);
+    J->used += 2 + rec->len;
+}
+
+/*Agrega al grupo los bytes de una operación (sin revisar si ya toca escribirlo)*/
+static void journalRecord(journal *J, int op, record *rec, record *rec2){
+    size_t len = 3 + rec->len + (rec2 != NULL ? 2 + rec2->len : 0);
+    if(J->used + len > J->cap){
+        size_t cap = J->cap ? J->cap*2 : 1 << 16;
+        while(J->used + len > cap)
+            cap *= 2;
+        unsigned char *bytes = (unsigned char*)realloc(J->bytes, cap);
+        if(bytes == NULL){
+            fprintf(stderr, "Error en malloc!\n");
+            exit(1);
+        }
+        J->bytes = bytes;
+        J->cap = cap;
+    }
+    J->bytes[J->used++] = (unsigned char)op;
+    journalKey(J, rec);
+    if(rec2 != NULL)
+        journalKey(J, rec2);
+}
+
+/*Función para agregar una operación al grupo ("rec2" es la segunda llave de "update" o NULL)*/
+void journalAppend(journal *J, int op, record *rec, record *rec2){
+    if(J->fd < 0)
+        return;
+    if(rec->len > JOURNAL_MAX_KEY || (rec2 != NULL && rec2->len > JOURNAL_MAX_KEY)){
+        fprintf(stderr, "Llave demasiado larga para el journal (no se guardo la operacion)\n");
+        return;
+    }
+    journalRecord(J, op, rec, rec2);
+    //El reloj se consulta una vez por operación (CLOCK_MONOTONIC_COARSE no entra al kernel)
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+    if(J->ops++ == 0)
+        J->first = now;
+    long waited = (now.tv_sec - J->first.tv_sec)*1000000000L + (now.tv_nsec - J->first.tv_nsec);
+    if(J->ops >= J->group || waited >= J->interval)
+        journalCommit(J);
+}
+
+/*Vacía el journal después de un snapshot (que ya contiene todas sus operaciones). El journal nuevo empieza con un
+ * OP_RESTORE_SUM del snapshot ("base", ruta absoluta, con su suma "sum"): al reproducirlo se parte de ese snapshot
+ * aunque no se use "-r", y si ya no existe o cambió, no se reproduce*/
+//NOTA: El journal nuevo se escribe aparte y se renombra sobre el anterior: si el programa se cae a la mitad, queda
+//... completo uno de los dos (nunca un journal vacío que se reproduciría sobre un quash vacío)
+void journalReset(journal *J, const char *base, uint64_t sum){
+    if(J->fd < 0)
+        return;
+    J->used = 0;
+    J->ops = 0;
+    record base_rec = {(void*)base, strlen(base)}, sum_rec = {&sum, sizeof(uint64_t)};
+    journalRecord(J, OP_RESTORE_SUM, &base_rec, &sum_rec);
+    char tmp[4096 + 8];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", J->path);
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    int ok = fd >= 0 && writeAll(fd, J->bytes, J->used) && fdatasync(fd) == 0;
+    if(fd >= 0)
+        ok = (close(fd) == 0) && ok;
+    if(!ok || rename(tmp, J->path) != 0){
+        fprintf(stderr, "No se pudo vaciar el journal\n");
+        exit(1);
+    }
+    //El renombre también debe quedar en el disco (se sincroniza el directorio)
+    char dir[4096];
+    const char *slash = strrchr(J->path, '/');
+    snprintf(dir, sizeof(dir), "%.*s", slash ? (int)(slash - J->path) + 1 : 1, slash ? J->path : ".");
+    int dir_fd = open(dir, O_RDONLY);
+    if(dir_fd >= 0){
+        fsync(dir_fd);
+        close(dir_fd);
+    }
+    close(J->fd);
+    J->fd = open(J->path, O_RDWR | O_APPEND);
+    if(J->fd < 0){
+        fprintf(stderr, "No se pudo abrir el journal %s\n", J->path);
+        exit(1);
+    }
+    J->used = 0;
+}
+
+/*Escribe lo pendiente y cierra el journal*/
+void closeJournal(journal *J){
+    journalCommit(J);
+    if(J->fd >= 0)
+        close(J->fd);
+    free(J->bytes);
+    free(J->path);
+    initJournal(J);
+}
+
+//NOTA: El bit más alto de heap_item.hash_index guarda la marca de la tabla donde está el elemento. Así, durante una
+//... migración, cada nodo del heap sabe si su elemento sigue en la tabla anterior o ya está en la nueva
+#define TAG_SHIFT (sizeof(size_t)*8 - 1)
+
+/*Índice de tabla (con la marca de la tabla actual) que se guarda en un nodo del heap*/
+static inline size_t tagIndex(HTable_OA *HT, size_t index){
+    return index | (HT->tag << TAG_SHIFT);
+}
+
+/*Elemento de la tabla al que apunta un nodo del heap (en la tabla actual o en la anterior)*/
+static inline hash_item* heapSlot(HTable_OA *HT, size_t hash_index){
+    size_t index = hash_index & ~((size_t)1 << TAG_SHIFT);
+    if((hash_index >> TAG_SHIFT) == HT->tag)
+        return &HT->table[index];
+    return &HT->old_table[index];
+}
+
+/*Función para que el nodo del heap de la casilla "index" apunte a ella (en la tabla actual o en la anterior)*/
+static inline void linkSlot(HTable_OA *HT, int old, size_t index){
+    hash_item *table = old ? HT->old_table : HT->table;
+    size_t tag = old ? HT->tag^1 : HT->tag;
+    HT->h->array[table[index].heap_index].hash_index = index | (tag << TAG_SHIFT);
+}
+
 //IMPORTANTE: Nótese de la última estructura que se vincula el Heap directamente como parte de la hash table
 
+/*Función para reservar e inicializar el arreglo de elementos hash de una tabla*/
+hash_item* newTableArray(size_t size, int huge){
+    //Reservamos memoria para el arreglo de los elementos hash (la tabla misma)
+    hash_item *table = (hash_item*)allocBlock(sizeof(hash_item)*size, huge, YES);
+    if(table == NULL){                                          //Si table es NULL, MALLOC no pudo reservar más memoria
+        fprintf(stderr, "Cannot allocate memory for table.");
+        exit(1);
+    }
+    return table;
+}
+
+/*Función para reservar e inicializar los datos de sondeo de una tabla (todas las casillas libres)*/
+hash_meta* newMetaArray(size_t size, int huge){
+    hash_meta *meta = (hash_meta*)allocBlock(sizeof(hash_meta)*size, huge, NO);
+    if(meta == NULL){
+        fprintf(stderr, "Cannot allocate memory for table.");
+        exit(1);
+    }
+    for(size_t i = 0; i<size; i++){
+        meta[i].key = 0;
+        meta[i].status = NOTVALID;
+        meta[i].lazy_deleted = NO;
+        meta[i].leapt = NO;
+    }
+    return meta;
+}
+
+/************************BYTES DE CONTROL (SONDEO SW)***************************************/
+//NOTA: Cada casilla tiene un byte: CTRL_EMPTY, CTRL_DELETED o, si está ocupada, 7 bits de su llave (bit alto en 0).
+//... Las búsquedas comparan 16 bytes a la vez y sólo leen el hash_item cuando coinciden esos 7 bits
+#define CTRL_EMPTY 0x80
+#define CTRL_DELETED 0xFE
+#define GROUP 16                    //Casillas que se revisan en cada paso
+
+/*Fragmento de 7 bits de la llave que se guarda en el byte de control*/
+//NOTA: Se multiplica por una constante impar para que los 7 bits altos dependan de toda la llave (adler32 casi no
+//... usa sus bits altos con llaves cortas)
+static inline uint8_t ctrlHash(hash_t key){
+#if HASH_BITS == 64
+    return (key * 0x9E3779B97F4A7C15ull) >> 57;
+#else
+    return (uint32_t)(key * 0x9E3779B1u) >> 25;
+#endif
+}
+
+/*Función para reservar los bytes de control de una tabla de "size" casillas (todas vacías)*/
+//NOTA: Se reservan GROUP bytes de más que copian a los primeros, para leer un grupo sin partirlo al final del arreglo
+uint8_t* newCtrlArray(size_t size, int huge){
+    uint8_t *ctrl = (uint8_t*)allocBlock(size + GROUP, huge, NO);
+    if(ctrl == NULL){
+        fprintf(stderr, "Cannot allocate memory for table.");
+        exit(1);
+    }
+    memset(ctrl, CTRL_EMPTY, size + GROUP);
+    return ctrl;
+}
+
+/*Asigna el byte de control de una casilla (y su copia, si es de las primeras)*/
+static inline void setCtrl(uint8_t *ctrl, size_t size, size_t index, uint8_t value){
+    ctrl[index] = value;
+    if(index < GROUP)
+        ctrl[size + index] = value;
+}
+
+//Máscaras de bits de un grupo (el bit i corresponde a la casilla inicio+i)
+#ifdef __SSE2__
+/*Casillas del grupo cuyo byte de control es "value"*/
+static inline uint32_t ctrlMatch(const uint8_t *group, uint8_t value){
+    __m128i bytes = _mm_loadu_si128((const __m128i*)group);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8((char)value)));
+}
+/*Casillas del grupo vacías o borradas (las únicas con el bit alto encendido)*/
+static inline uint32_t ctrlFree(const uint8_t *group){
+    return _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)group));
+}
+#else
+static inline uint32_t ctrlMatch(const uint8_t *group, uint8_t value){
+    uint32_t mask = 0;
+    for(int i=0; i<GROUP; i++)
+        mask |= (uint32_t)(group[i] == value) << i;
+    return mask;
+}
+static inline uint32_t ctrlFree(const uint8_t *group){
+    uint32_t mask = 0;
+    for(int i=0; i<GROUP; i++)
+        mask |= (uint32_t)(group[i] >> 7) << i;
+    return mask;
+}
+#endif
+
+/*Tamaño de la tabla con índice de capacidad "index"*/
+static inline size_t tableSize(const HTconfig *cfg, size_t index){
+    return cfg->pow2 ? (size_t)1 << (POW2_MIN_BITS + index) : HASH_SIZE[index];
+}
+
+/*Cantidad de índices de capacidad (el último es el tamaño máximo de la tabla)*/
+static inline size_t tableCount(const HTconfig *cfg){
+    return cfg->pow2 ? POW2_MAX_BITS - POW2_MIN_BITS + 1 : TABLE_SIZES;
+}
+
 /*Función para hacer una nueva tabla Hash con Open Addressing*/
-HTable_OA* newHTableCap_OA(size_t index){
+HTable_OA* newHTableCap_OA(size_t index, HTconfig cfg){
     //Reservamos memoria para la tabla Hash
     HTable_OA *HT = (HTable_OA*)malloc(sizeof(HTable_OA)*1);        //Reserva memoria para la tabla
     if(HT == NULL){                                                //Si HT es NULL, MALLOC no pudo reservar más memoria
         fprintf(stderr, "Cannot allocate memory for table.");
         exit(1);
     }
-    //Reservamos memoria para el arreglo de los elementos hash (la tabla misma)
-    HT->table = (hash_item*)calloc(HASH_SIZE[index], sizeof(hash_item));    
-    if(HT->table == NULL){                                          //Si table es NULL, MALLOC no pudo reservar más memoria
-        fprintf(stderr, "Cannot allocate memory for table.");
-        exit(1);
-    }
+    HT->table = newTableArray(tableSize(&cfg, index), cfg.huge);
+    HT->meta = newMetaArray(tableSize(&cfg, index), cfg.huge);
     //Si llegamos aquí, entonces sí se pudo reservar memoria
-    HT->size = HASH_SIZE[index];                              //Indicar el tamaño de la tabla
+    HT->size = tableSize(&cfg, index);                              //Indicar el tamaño de la tabla
     HT->index_size = index;                                   //Indicar el índice de tamaño
+    HT->cfg = cfg;                                            //Indicar las opciones (familia hash, modo numérico)
     //Inicializamos en 0 la cantidad de elementos ocupados en total(apenas es nueva la tabla)
     HT->occupied_elements = 0;
-    for(size_t i = 0; i<HT->size; i++){
-        HT->table[i].status = NOTVALID;
-        HT->table[i].lazy_deleted = NO;
-        HT->table[i].leapt = NO;
-        HT->table[i].heap_index = 0;
-    }
+    //Arena para las llaves (en modo numérico queda vacía)
+    initArena(&HT->keys, 1024);
+    //Sin migración en curso
+    HT->old_table = NULL;
+    HT->old_meta = NULL;
+    HT->old_size = 0;
+    HT->old_index_size = 0;
+    HT->migrate_pos = 0;
+    HT->tag = 0;
+    //Bytes de control (sólo con sondeo SW)
+    HT->ctrl = (cfg.probing == SW) ? newCtrlArray(HT->size, cfg.huge) : NULL;
+    HT->old_ctrl = NULL;
+    HT->tombstones = 0;
+    HT->hist = 0;
+    HT->mapped = NO;
+    HT->old_mapped = NO;
+    memset(&HT->out, 0, sizeof(out_buffer));
+    initJournal(&HT->wal);
+    HT->out.wal = &HT->wal;
+    memset(&HT->stats, 0, sizeof(quash_stats));
 
     //Se declara un nuevo Heap
-    HT->h = newHeap();
+    HT->h = newHeap(cfg.numeric, cfg.huge, cfg.engine, &HT->keys);
     return HT;
     }
 
 
 /*Aquí definimos una función para generar una tabla Hash con arreglos con el primer tamaño disponible*/
-HTable_OA* newHTable_OA(){
-    return newHTableCap_OA(0);
+HTable_OA* newHTable_OA(HTconfig cfg){
+    return newHTableCap_OA(0, cfg);
 }
 
-/*Función para liberar el espacio de toda la tabla (elemento por elemento)*/
+/*Función para liberar los arreglos de una tabla de "size" casillas (la actual o la anterior)*/
+static inline void releaseTables(hash_item *table, hash_meta *meta, uint8_t *ctrl, size_t size, int mapped, int huge){
+    releaseBlock(table, sizeof(hash_item)*size, mapped, huge);
+    releaseBlock(meta, sizeof(hash_meta)*size, mapped, huge);
+    releaseBlock(ctrl, size + GROUP, mapped, huge);
+}
+
+/*Función para liberar el espacio de toda la tabla*/
 void freeHTable_OA(HTable_OA *HT){
-    //Se libera elemento por elemento
-    for(size_t i=0; i<HT->size; i++){
-        //Se libera los espacios reservados para el contenido en cada elemento
-        //free(HT->table[i].rec.bytes);
-    }
-    free(HT->table);
+    //Todas las llaves están en la arena: se liberan de una sola vez
+    freeArena(&HT->keys);
+    releaseTables(HT->table, HT->meta, HT->ctrl, HT->size, HT->mapped, HT->cfg.huge);
+    releaseTables(HT->old_table, HT->old_meta, HT->old_ctrl, HT->old_size, HT->old_mapped, HT->cfg.huge);
+    //Las operaciones pendientes del journal y lo que quede en el buffer de salida se escriben antes de liberarlos
+    closeJournal(&HT->wal);
+    outFlush(&HT->out);
+    free(HT->out.bytes);
     //Se libera espacio del Heap
     freeHeap(HT->h);
     assert(HT->table != NULL);//"Asegúrate de que el arreglo de cabezas no es nulo"
@@ -158,61 +947,267 @@ void freeHTable_OA(HTable_OA *HT){
 }
 
 //Funcion para sacar el módulo de una llave
-static inline size_t hashFunction(uint32_t key, size_t hashSize){ //static inline hace que el compilador tome el argumento y opere hashFunction sin considerarla como funcion
+//NOTA: Los tamaños de HASH_SIZE son primos (impares) y los de "pow2" son pares: con ellos basta una máscara (sin dividir)
+static inline size_t hashFunction(hash_t key, size_t hashSize){ //static inline hace que el compilador tome el argumento y opere hashFunction sin considerarla como funcion
+    if(!(hashSize & 1))
+        return key & (hashSize - 1);
     return key % hashSize;
 }
 
+/*Mezclador de 32 bits (el final de murmur3): con tamaños potencia de dos la casilla sale de los bits bajos de la llave,
+ * y los de adler32 casi no cambian entre llaves parecidas*/
+static inline uint32_t mix32(uint32_t key){
+    key ^= key >> 16;
+    key *= 0x85ebca6bu;
+    key ^= key >> 13;
+    key *= 0xc2b2ae35u;
+    key ^= key >> 16;
+    return key;
+}
+
+/*Mezclador de 64 bits (el final de splitmix64): reparte los 32 bits de adler32 en los 64 de la llave*/
+static inline uint64_t mix64(uint64_t key){
+    key ^= key >> 30;
+    key *= 0xbf58476d1ce4e5b9ull;
+    key ^= key >> 27;
+    key *= 0x94d049bb133111ebull;
+    key ^= key >> 31;
+    return key;
+}
+
+/*Función para calcular la llave de un record con la familia hash "hash_type"*/
+//NOTA: Con HASH_BITS=32 el resultado de 64 bits se pliega a 32 (XOR de ambas mitades) para guardarlo en hash_meta.key
+static inline hash_t hashKey(int hash_type, record *rec){
+    uint64_t h;
+    switch (hash_type)
+    {
+    case H_ADLER:
+        return adler32((unsigned char*)rec->bytes, rec->len);
+    default:
+        h = wyhash64((unsigned char*)rec->bytes, rec->len);
+#if HASH_BITS == 64
+        return h;
+#else
+        return (uint32_t)(h ^ (h >> 32));
+#endif
+    }
+}
+
+/*Llave de un record según la familia hash de la tabla*/
+static inline hash_t hashRecord(HTable_OA *HT, record *rec){
+    hash_t key = hashKey(HT->cfg.hash_type, rec);
+    //wyhash ya está mezclado; adler32 se mezcla antes de usar sus bits bajos (y, con 64 bits, para llenar los altos:
+    //... si no, ninguna llave caería en las casillas después de la 2^32)
+#if HASH_BITS == 64
+    if(HT->cfg.hash_type == H_ADLER)
+        return mix64(key);
+#else
+    if(HT->cfg.pow2 && HT->cfg.hash_type == H_ADLER)
+        return mix32(key);
+#endif
+    return key;
+}
+
+/*Record con los bytes de la llave de un elemento de la tabla (en modo numérico son los 8 bytes de "num")*/
+static inline record slotRecord(HTable_OA *HT, hash_item *item){
+    record rec;
+    if(HT->cfg.numeric){
+        rec.bytes = &item->num;
+        rec.len = sizeof(int64_t);
+        return rec;
+    }
+    return arenaView(&HT->keys, item->ref);
+}
+
 /*Prototipos para poder usar la función de insertar en la función "Remodel"*/
 hash_item* HTinsertRecord_OA(HTable_OA **HT, record *rec, int mode);
+size_t findFreeSlot(HTable_OA **HT, hash_t key, size_t mode);
 void heapifyUp(heap **h, size_t index, HTable_OA **HT);
-void insertHeap(record *rec, heap **h, HTable_OA **HT);
+void insertHeap(uint64_t ref, heap **h, HTable_OA **HT);
+void RHRemoveSlot(HTable_OA *HT, int old, size_t index);
+
+/*Función para compactar la arena: copia las llaves vivas a una arena nueva y actualiza los refs de tabla y heap*/
+void compactArena(HTable_OA *HT){
+    key_arena previousKeys = HT->keys;
+    initArena(&HT->keys, previousKeys.used - previousKeys.dead);
+    for(size_t i=0; i<HT->size; i++){
+        hash_item *item = &HT->table[i];
+        if(HT->meta[i].status != VALID)
+            continue;
+        record rec = arenaView(&previousKeys, item->ref);
+        arenaIntern(&HT->keys, &rec, &item->ref);
+        HT->h->array[item->heap_index].ref = item->ref;
+    }
+    freeArena(&previousKeys);
+    HT->stats.compactions++;
+}
+
+/*Función para colocar en la tabla actual un elemento de otra tabla (conserva su llave, su ref y su lugar en el heap)*/
+static inline void moveSlot(HTable_OA *HT, hash_meta *meta, hash_item *item, size_t mode){
+    size_t index = findFreeSlot(&HT, meta->key, mode);
+    HT->table[index] = *item;
+    HT->meta[index].key = meta->key;
+    HT->meta[index].status = VALID;
+    //El nodo del heap ahora apunta a la nueva posición en la tabla
+    linkSlot(HT, NO, index);
+}
+
+/*Función para migrar hasta "steps" casillas de la tabla anterior a la actual (modo incremental)*/
+void migrateStep(HTable_OA *HT, size_t steps, size_t mode){
+    if(HT->old_table == NULL)
+        return;
+    while(steps>0 && HT->migrate_pos<HT->old_size){
+        hash_meta *meta = &HT->old_meta[HT->migrate_pos];
+        steps--;
+        if(meta->status == VALID){
+            moveSlot(HT, meta, &HT->old_table[HT->migrate_pos], mode);
+            //Con Robin Hood se recorre hacia atrás el resto de la cadena; la misma casilla se vuelve a revisar
+            if(mode == RH){
+                RHRemoveSlot(HT, YES, HT->migrate_pos);
+                continue;
+            }
+            //La casilla queda como borrada para que las búsquedas en la tabla anterior sigan de largo
+            meta->status = NOTVALID;
+            meta->lazy_deleted = YES;
+            if(mode == SW)
+                setCtrl(HT->old_ctrl, HT->old_size, HT->migrate_pos, CTRL_DELETED);
+        }
+        HT->migrate_pos++;
+    }
+    //Si ya se revisó toda la tabla anterior, termina la migración
+    if(HT->migrate_pos == HT->old_size){
+        releaseTables(HT->old_table, HT->old_meta, HT->old_ctrl, HT->old_size, HT->old_mapped, HT->cfg.huge);
+        HT->old_mapped = NO;
+        HT->old_table = NULL;
+        HT->old_meta = NULL;
+        HT->old_ctrl = NULL;
+        HT->old_size = 0;
+        //Si la mitad o más de la arena son llaves borradas, se compacta (sólo se copian las llaves vivas)
+        if(!HT->cfg.numeric && HT->keys.dead > 0 && HT->keys.dead*2 >= HT->keys.used)
+            compactArena(HT);
+    }
+}
+
+/*Función para reacomodar el contenido del quash en una tabla nueva con el índice de tamaño "newIndex"*/
+//NOTA: Las llaves no se copian ni se vuelven a calcular: cada elemento conserva su ref y su llave hash, y el heap
+//... sigue siendo el mismo (sólo se actualiza el índice de tabla de cada nodo)
+//NOTA 2: En modo incremental sólo se coloca la tabla nueva; los elementos se mudan poco a poco con migrateStep
+HTable_OA* RemodelHTableTo_OA(HTable_OA *HT, size_t newIndex, size_t mode){
+    uint64_t start = statsClock();
+    HT->stats.remodels++;
+    //Si todavía había una migración en curso, primero se termina
+    while(HT->old_table != NULL)
+        migrateStep(HT, HT->old_size, mode);
+    //Guardamos la tabla anterior y colocamos una nueva (vacía) con el nuevo índice
+    hash_item *previous = HT->table;
+    hash_meta *previousMeta = HT->meta;
+    uint8_t *previousCtrl = HT->ctrl;
+    size_t previousSize = HT->size;
+    size_t previousIndex = HT->index_size;
+    HT->size = tableSize(&HT->cfg, newIndex);
+    HT->table = newTableArray(HT->size, HT->cfg.huge);
+    HT->meta = newMetaArray(HT->size, HT->cfg.huge);
+    HT->index_size = newIndex;
+    if(mode == SW)
+        HT->ctrl = newCtrlArray(HT->size, HT->cfg.huge);
+    HT->tombstones = 0;
+
+    if(HT->cfg.incremental){
+        //La tabla anterior se queda para las búsquedas; la nueva lleva la otra marca
+        HT->old_table = previous;
+        HT->old_meta = previousMeta;
+        HT->old_ctrl = previousCtrl;
+        HT->old_size = previousSize;
+        HT->old_index_size = previousIndex;
+        HT->old_mapped = HT->mapped;
+        HT->mapped = NO;
+        HT->migrate_pos = 0;
+        HT->tag ^= 1;
+        HT->stats.remodel_ns += statsClock() - start;
+        return HT;
+    }
+
+    //Aquí se coloca cada elemento válido de la tabla anterior en la nueva
+    for(size_t i=0; i<previousSize; i++){
+        if(previousMeta[i].status == VALID)
+            moveSlot(HT, &previousMeta[i], &previous[i], mode);
+    }
+    //Liberamos el espacio de la tabla antigua
+    releaseTables(previous, previousMeta, previousCtrl, previousSize, HT->mapped, HT->cfg.huge);
+    HT->mapped = NO;
+    //Si la mitad o más de la arena son llaves borradas, se aprovecha el remodelado para compactarla
+    if(!HT->cfg.numeric && HT->keys.dead > 0 && HT->keys.dead*2 >= HT->keys.used)
+        compactArena(HT);
+    HT->stats.remodel_ns += statsClock() - start;
+    return HT;
+    }
 
-/*Función para para expandir o reducir espacio: reserva memoria y reacomoda el contenido de un quash ya existente*/
-HTable_OA* RemodelHTableCap_OA(HTable_OA *PreviousHT, int state, size_t mode){
+/*Función para para expandir o reducir espacio: reserva una nueva tabla y reacomoda en ella el contenido del quash*/
+HTable_OA* RemodelHTableCap_OA(HTable_OA *HT, int state, size_t mode){
     //Variable auxiliar para guardar el índice de tamaño de la tabla antigua
-    size_t newIndex = PreviousHT->index_size;
+    size_t newIndex = HT->index_size;
     //Ahora aumentamos o disminuimos el tamaño de la tabla según el valor de "state"
     if(state==FULL)
         newIndex+=1;                                       //Incrementamos el valor del cap_type (avanzamos en el arreglo de capacidades)
     if(state==EMPTY)
         newIndex-=1;                                       //Decrementamos el valor del cap_type (retrocedemos en el arreglo de capacidades)
+    //Si state es DIRTY, se conserva el tamaño (sólo se eliminan las marcas de borrado)
 
     //Aquí aseguramos que state no sea 0. Si es así, entonces hubo un erro al mandar llamar la función sin necesidad
     //...(DETENTE si la tabla no está ni llena ni vacía)
     assert(state!=0);
-    //Creamos una nueva tabla con el nuevo índice
-    HTable_OA *HT = newHTableCap_OA(newIndex);
-    
-    //Aquí se insertará cada elemento del Heap del quash anterior al nuevo
-    size_t current_index = PreviousHT->h->index;
-    for(size_t i=1; i<=current_index; i++){
-        PreviousHT->h->index = 0;
-        //Se inserta tanto en el Heap como en la tabla hash del quash
-        hash_item *aux = HTinsertRecord_OA(&HT, &(PreviousHT->h->array[i].rec), mode);
-        insertHeap(&(PreviousHT->h->array[i].rec), &(HT->h), &HT);
+    return RemodelHTableTo_OA(HT, newIndex, mode);
     }
 
-    //Liberamos el espacio de la tabla antigua
-    freeHTable_OA(PreviousHT);
-    //Regresamos la nueva tabla (con el contenido incluído)
-    return HT;
-    }
+/*"percent" por ciento de "size" (redondeado hacia abajo, sin desbordarse con tablas enormes)*/
+static inline size_t percentOf(size_t size, int percent){
+    return size/100*percent + size%100*percent/100;
+}
+
+/*Elementos que caben en una tabla de "size" casillas sin pasar la carga máxima*/
+//NOTA: Por defecto es el 50% (7/8 con SW, que cuenta también las tumbas)
+static inline size_t loadLimit(const HTconfig *cfg, size_t size){
+    if(cfg->max_load > 0)
+        return percentOf(size, cfg->max_load);
+    return (cfg->probing == SW) ? size/8*7 : size/2;
+}
+
+/*Elementos bajo los que una tabla de "size" casillas se reduce (sin contar la histéresis). Por defecto, el 10%*/
+static inline size_t shrinkLimit(const HTconfig *cfg, size_t size){
+    return cfg->min_load > 0 ? percentOf(size, cfg->min_load) : size/10;
+}
 
 /*Función para evaluar si la tabla está llena o vacía (relativamente hablando)*/
 //NOTA: "operation" indica si se mandó llamar la función para insertar ("UP") o para borrar ("DOWN") elementos
 int checkSizeOA(HTable_OA *HT, int operation){
-    //Checamos si la cantidad de elementos ocupados es mayor al 50% de capacidad. Si es así, está llena.
-    if((HT->occupied_elements>(HT->size/2))&&(operation==UP))
-        return FULL;
-    //Ahora, se evalúa si la cantidad de elementos ocupados es menor que un cuarto de la capacidad total
-    //NOTA: Aquí le sumamos el cuadrado de la variable global "hist" (histéresis)
+    //Con sondeo SW la tabla admite hasta 7/8 de carga, contando las casillas marcadas como borradas. Si se pasa
+    //... pero la mayoría eran marcas, basta con reacomodarla en el mismo tamaño
+    //NOTA: Con el tamaño máximo ya no se crece (la carga sigue subiendo hasta que no quede lugar)
+    int largest = HT->index_size + 1 >= tableCount(&HT->cfg);
+    if(HT->cfg.probing == SW && operation == UP){
+        size_t limit = loadLimit(&HT->cfg, HT->size);
+        if(HT->occupied_elements + HT->tombstones <= limit)
+            return 0;
+        if(HT->occupied_elements <= limit/28*25)
+            return DIRTY;
+        return largest ? 0 : FULL;
+    }
+    //Checamos si la cantidad de elementos ocupados es mayor a la carga máxima (50% por defecto). Si es así, está llena.
+    if((HT->occupied_elements>loadLimit(&HT->cfg, HT->size))&&(operation==UP))
+        return largest ? 0 : FULL;
+    //Ahora, se evalúa si la cantidad de elementos ocupados es menor que la carga mínima (10% por defecto)
+    //NOTA: Aquí le sumamos el cuadrado de la histéresis "hist" de la tabla
     size_t aux1 = HT->occupied_elements;
-    size_t aux2 = HT->size/10 +(hist*hist);
+    size_t aux2 = shrinkLimit(&HT->cfg, HT->size) +(HT->hist*HT->hist);
     if((HT->occupied_elements<(aux2))&&(operation==DOWN)){
-        //Por supuesto, si tenemos el menor tamaño posible, no mandamos "empty" para no reducir (ya no se puede)
-        if((HT->index_size)>0)
-            hist++;                 //Aumentamos el valor de la histéresis en 1 (cada vez que se reduzca la tabla)
+        //Por supuesto, si tenemos el menor tamaño posible, no mandamos "empty" para no reducir (ya no se puede).
+        //Tampoco se reduce si los elementos no caben en la tabla menor sin que ésta quede llena
+        if((HT->index_size)>0 && HT->occupied_elements <= loadLimit(&HT->cfg, tableSize(&HT->cfg, HT->index_size-1))){
+            //Aumentamos el valor de la histéresis (en 1 por defecto) cada vez que se reduzca la tabla
+            if(HT->cfg.hysteresis >= 0)
+                HT->hist += HT->cfg.hysteresis > 0 ? HT->cfg.hysteresis : 1;
             return EMPTY;
+        }
     }
     return 0;
 }
@@ -220,56 +1215,195 @@ int checkSizeOA(HTable_OA *HT, int operation){
 /*Prototipo de función para checar los bytes entre dos contenidos y ver si son iguales o no*/
 int checkMatchRecord(record *A, record *B);
 
+/*Función para checar si un elemento de la tabla guarda un record*/
+//NOTA: Sólo se llama con elementos válidos (los borrados ya no tienen su contenido); véase matchIndex
+static inline int matchSlot(HTable_OA *HT, hash_item *item, record *rec){
+    //En modo numérico basta con comparar los enteros; en el de cadenas se descarta por longitud antes de ir a la arena
+    if(HT->cfg.numeric){
+        int64_t num;
+        memcpy(&num, rec->bytes, sizeof(int64_t));
+        return (item->num == num) ? YES : NO;
+    }
+    if(refLen(item->ref) != rec->len)
+        return NO;
+    record stored = arenaView(&HT->keys, item->ref);
+    return checkMatchRecord(&stored, rec);
+}
+
+/*Función para checar si la casilla "index" guarda el record: primero se revisan sus datos de sondeo (válida y con la
+misma llave hash) y sólo entonces se lee el elemento*/
+static inline int matchIndex(HTable_OA *HT, hash_meta *meta, hash_item *table, size_t index, hash_t key, record *rec){
+    if(meta[index].status != VALID || meta[index].key != key)
+        return NO;
+    return matchSlot(HT, &table[index], rec);
+}
+
 //************************************FUNCIONES PARA LAS OPERACIONES BÁSICAS*******************************************************************************************
 /************************SONDEO PARA BUSCAR ELEMENTOS***************************************/
 /*NOTA: index es el resultado de la función hash original*/
+/*Siguiente casilla del sondeo lineal (LP) o cuadrático (QP) después de "i" colisiones*/
+//NOTA: Con QP y un tamaño primo, las primeras size/2 casillas del recorrido son distintas; como la tabla nunca pasa
+//... del 50% de carga, siempre hay una libre entre ellas
+static inline size_t probeNext(size_t mode, size_t home, size_t index, size_t i, size_t size){
+    if(mode == LP)
+        return (index+1 == size) ? 0 : index+1;
+    //Con tamaños potencia de dos se usan los números triangulares i(i+1)/2, que sí recorren todas las casillas
+    if(!(size & 1))
+        return (home + i*(i+1)/2) & (size - 1);
+    return (home + i*i) % size;
+}
+
+/*Paso del double hashing: R - (llave mod R), siendo R el primo anterior al tamaño en HASH_SIZE (19 para el primero)*/
+//NOTA: Con tamaños potencia de dos no se divide: cualquier paso impar recorre toda la tabla (los saltos acumulados son
+//... múltiplos impares de los números triangulares), así que se toman los bits altos de la llave
+static inline size_t DHStep(size_t key, size_t size, size_t index_size){
+    if(!(size & 1))
+        return (key >> (HASH_BITS/2)) | 1;
+    size_t R = (index_size == 0) ? 19 : HASH_SIZE[index_size - 1];
+    return R - hashFunction(key, R);
+}
+
+/*Función para buscar una llave con sondeo lineal o cuadrático (mismas marcas de borrado que double hashing)*/
+hash_item* ProbeFindKey(HTable_OA **HT, int old, size_t mode, size_t key, record *rec){
+    hash_item *table = old ? (*HT)->old_table : (*HT)->table;
+    hash_meta *meta = old ? (*HT)->old_meta : (*HT)->meta;
+    size_t size = old ? (*HT)->old_size : (*HT)->size;
+    size_t home = hashFunction(key, size);
+    size_t index = home;
+    //Se sigue de largo mientras la casilla sea un borrado o alguien la haya saltado al insertar
+    for(size_t i=0; i<size; i++){
+        if(matchIndex(*HT, meta, table, index, key, rec)==YES)
+            return (&table[index]);
+        if(meta[index].lazy_deleted==NO && meta[index].leapt==NO)
+            return NULL;
+        index = probeNext(mode, home, index, i+1, size);
+    }
+    return NULL;
+}
+
 /*Función para buscar un espacio de tabla disponible con double hashing*/
-hash_item* DHFindKey(HTable_OA **HT, size_t key, record *rec){
-    size_t index = hashFunction(key, (*HT)->size);
+//NOTA: Si "old" es YES se busca en la tabla anterior (durante una migración incremental)
+hash_item* DHFindKey(HTable_OA **HT, int old, size_t key, record *rec){
+    hash_item *table = old ? (*HT)->old_table : (*HT)->table;
+    hash_meta *meta = old ? (*HT)->old_meta : (*HT)->meta;
+    size_t size = old ? (*HT)->old_size : (*HT)->size;
+    size_t index_size = old ? (*HT)->old_index_size : (*HT)->index_size;
+    size_t index = hashFunction(key, size);
     //La variable i representa la cantidad de colisiones
     size_t i = 0;
     //Si hubo coincidencia con la llave, se regresa el hash item correspondiente
-    if(checkMatchRecord(&((*HT)->table[index].rec), rec)==YES)
-        return (&(*HT)->table[index]);
-    //Ciclo que recorre toda la tabla hasta dar con un espacio disponible (función anticolisiones: f(i)= R - i mod R, ...
-    //... siendo R un número primo menor a HASH_SIZE)
-    //Se define primeramente R (véase comentario anterior) con el número primo previo al de HASH_SIZE según el
-    //arreglo de capacidades posibles. Sólo se hace la excepción para cuando es la primera capacidad posible
-    size_t R;
-    //Si el tamaño de la tabla es el mínimo, establecemos R=3 (primo menor al mínimo tamaño, el cual es 5)
-    if((*HT)->size <= 5){
-        R = 3;
+    if(matchIndex(*HT, meta, table, index, key, rec)==YES){
+        countProbes((*HT)->stats.find_probes, 0);
+        return (&table[index]);
     }
-    else
-    //Se establece como R el primo menor anterior en el arreglo de capacidades
-        R = HASH_SIZE[(*HT)->index_size - 1];
-    size_t Hash2;
-     while(((*HT)->table[index].lazy_deleted==YES || (*HT)->table[index].leapt==YES)){
+    //Ciclo que recorre toda la tabla hasta dar con un espacio disponible (función anticolisiones: f(i)= R - i mod R, ...
+    //... siendo R un número primo menor a HASH_SIZE; véase DHStep). El paso se calcula una sola vez
+    size_t Hash2 = DHStep(key, size, index_size);
+    //NOTA: Como las banderas nunca se limpian, todo el recorrido podría estar marcado: se limita a "size" sondeos
+     while((meta[index].lazy_deleted==YES || meta[index].leapt==YES) && i<size){
         //Si hubo coincidencia con la llave, se regresa el hash item correspondiente
-        if(checkMatchRecord(&((*HT)->table[index].rec), rec)==YES)
-            return (&(*HT)->table[index]);
+        if(matchIndex(*HT, meta, table, index, key, rec)==YES){
+            countProbes((*HT)->stats.find_probes, i);
+            return (&table[index]);
+        }
         //Se incremente la cantidad de colisiones en 1
         i++;
         //Se realiza aquí el double hashing
-        Hash2 = R - hashFunction(key, R);
-        index = hashFunction((index + i*Hash2),(*HT)->size);     //Aquí se aplica h2(i) = (x + f(i)) mod HASH_SIZE
+        index = hashFunction((index + i*Hash2),size);     //Aquí se aplica h2(i) = (x + f(i)) mod HASH_SIZE
 
     }
+    countProbes((*HT)->stats.find_probes, i);
     //Si hubo coincidencia con la llave, se regresa el hash item correspondiente
-        if(checkMatchRecord(&((*HT)->table[index].rec), rec)==YES)
-            return (&(*HT)->table[index]);
+        if(matchIndex(*HT, meta, table, index, key, rec)==YES)
+            return (&table[index]);
     return NULL;
 }
 
-/***************************************************************************************/
+/*Distancia entre la casilla "index" y la casilla original (hash) del elemento que la ocupa*/
+static inline size_t RHDisplacement(hash_meta *meta, size_t index, size_t size){
+    size_t home = hashFunction(meta->key, size);
+    if(!(size & 1))
+        return (index - home) & (size - 1);
+    return (index + size - home) % size;
+}
+
+/*Función para buscar una llave con Robin Hood (sondeo lineal)*/
+//NOTA: La búsqueda termina en la primera casilla vacía o en cuanto el elemento de la casilla está más cerca de su
+//... casilla original que lo que ya se recorrió (si la llave existiera, Robin Hood la habría colocado antes)
+hash_item* RHFindKey(HTable_OA **HT, int old, size_t key, record *rec){
+    hash_item *table = old ? (*HT)->old_table : (*HT)->table;
+    hash_meta *meta = old ? (*HT)->old_meta : (*HT)->meta;
+    size_t size = old ? (*HT)->old_size : (*HT)->size;
+    size_t index = hashFunction(key, size);
+    for(size_t i=0; i<size; i++){
+        if(meta[index].status != VALID || RHDisplacement(&meta[index], index, size) < i)
+            return NULL;
+        if(matchIndex(*HT, meta, table, index, key, rec)==YES)
+            return (&table[index]);
+        index = (index+1 == size) ? 0 : index+1;
+    }
+    return NULL;
+}
+
+/*Función para buscar una llave con los bytes de control (sondeo SW)*/
+//NOTA: Se revisan grupos de GROUP casillas seguidos. Basta un byte vacío en el grupo para saber que la llave no está
+//... más adelante (al insertar se ocupa la primera casilla libre del recorrido)
+hash_item* SWFindKey(HTable_OA **HT, int old, hash_t key, record *rec){
+    hash_item *table = old ? (*HT)->old_table : (*HT)->table;
+    hash_meta *meta = old ? (*HT)->old_meta : (*HT)->meta;
+    uint8_t *ctrl = old ? (*HT)->old_ctrl : (*HT)->ctrl;
+    size_t size = old ? (*HT)->old_size : (*HT)->size;
+    uint8_t fragment = ctrlHash(key);
+    size_t pos = hashFunction(key, size);
+    for(size_t probed=0; probed<size; probed+=GROUP){
+        uint32_t mask = ctrlMatch(&ctrl[pos], fragment);
+        //Sólo se lee el elemento de las casillas cuyo fragmento coincide
+        while(mask){
+            size_t index = pos + __builtin_ctz(mask);
+            if(index >= size)
+                index -= size;
+            if(matchIndex(*HT, meta, table, index, key, rec)==YES)
+                return (&table[index]);
+            mask &= mask - 1;
+        }
+        if(ctrlMatch(&ctrl[pos], CTRL_EMPTY))
+            return NULL;
+        pos += GROUP;
+        if(pos >= size)
+            pos -= size;
+    }
+    return NULL;
+}
+
+/***************************************************************************************/
 /*Función para encontrar una llave en una tabla Hash*/
-hash_item* HTfindkey_OA(HTable_OA **HT, uint32_t key, size_t mode, record *rec){
+hash_item* HTfindkey_OA(HTable_OA **HT, hash_t key, size_t mode, record *rec){
+    hash_item *item;
     switch (mode)
     {
     //Se manda llamar la función para buscar una llave según see el modo operado
     case DH:
-        return DHFindKey(HT, key, rec);
-        break;
+        item = DHFindKey(HT, NO, key, rec);
+        //Durante una migración, lo que no está en la tabla nueva puede seguir en la anterior
+        if(item == NULL && (*HT)->old_table != NULL)
+            item = DHFindKey(HT, YES, key, rec);
+        return item;
+    case LP:
+    case QP:
+        item = ProbeFindKey(HT, NO, mode, key, rec);
+        if(item == NULL && (*HT)->old_table != NULL)
+            item = ProbeFindKey(HT, YES, mode, key, rec);
+        return item;
+    case RH:
+        item = RHFindKey(HT, NO, key, rec);
+        if(item == NULL && (*HT)->old_table != NULL)
+            item = RHFindKey(HT, YES, key, rec);
+        return item;
+    case SW:
+        item = SWFindKey(HT, NO, key, rec);
+        if(item == NULL && (*HT)->old_table != NULL)
+            item = SWFindKey(HT, YES, key, rec);
+        return item;
     default:
         break;
     }
@@ -296,57 +1430,180 @@ int checkMatchRecord(record *A, record *B){
 /*Función para encontrar un record en una tabla Hash*/
 hash_item* HTfindRecord_OA(HTable_OA **HT, record *rec, size_t mode){
     //Se calcula la llave de acuerdo al contenido
-    uint32_t key = adler32((unsigned char*)rec->bytes, rec->len);               //Encuentro la llave asociada a record (una cadena de longitud "len")
-    //Se manda llamar la función de encontrar llave
-    hash_item *item = HTfindkey_OA(HT, key, mode, rec);
-    if(item == NULL)
-        return NULL;
-    //Si se encontró la llave, se verifica si hay coincidencia en el contenido
-    if(checkMatchRecord(rec, &(item->rec))==YES)
-        return item;
-    return NULL;
+    hash_t key = hashRecord(*HT, rec);               //Encuentro la llave asociada a record (una cadena de longitud "len")
+    //Se manda llamar la función de encontrar llave (ésta ya verifica que el contenido coincida)
+    return HTfindkey_OA(HT, key, mode, rec);
 }
 
 /************************TIPOS DE SONDEO PARA INSERTAR ELEMENTOS***************************************/
+/*Función para buscar un espacio de tabla disponible con sondeo lineal o cuadrático*/
+size_t LinearQuadraticProbing(HTable_OA **HT, size_t mode, size_t key){
+    hash_meta *meta = (*HT)->meta;
+    size_t size = (*HT)->size;
+    size_t home = hashFunction(key, size);
+    size_t index = home;
+    size_t i = 0;
+    while(meta[index].status==VALID){
+        //Se marca el elemento actual como saltado
+        meta[index].leapt=YES;
+        i++;
+        index = probeNext(mode, home, index, i, size);
+    }
+    return index;
+}
+
 /*Función para buscar un espacio de tabla disponible con double hashing*/
 size_t DoubleHashing(HTable_OA **HT, size_t key){
+    hash_meta *meta = (*HT)->meta;
     size_t index = hashFunction(key, (*HT)->size);
     //La variable i representa la cantidad de colisiones
     size_t i = 0;
     //Ciclo que recorre toda la tabla hasta dar con un espacio disponible (función anticolisiones: f(i)= R - i mod R, ...
-    //... siendo R un número primo menor a HASH_SIZE)
-    //Se define primeramente R (véase comentario anterior) con el número primo previo al de HASH_SIZE según el
-    //arreglo de capacidades posibles. Sólo se hace la excepción para cuando es la primera capacidad posible
-    //size_t R = HASH_SIZE[(*HT)->index_size - 1];
-    size_t R;
-    if((*HT)->size <= 5){
-        R = 3;
-    }
-    else
-        R = HASH_SIZE[(*HT)->index_size - 1];
-    size_t Hash2;
-    while(((*HT)->table[index].status==VALID)){
+    //... siendo R un número primo menor a HASH_SIZE; véase DHStep). El paso se calcula una sola vez
+    size_t Hash2 = DHStep(key, (*HT)->size, (*HT)->index_size);
+    while((meta[index].status==VALID)){
         //Se incremente la cantidad de colisiones en 1
         i++;
         //Se marca el elemento actual como saltado
-        (*HT)->table[index].leapt=YES;
-        Hash2 = R - hashFunction(key, R);
+        meta[index].leapt=YES;
         index = hashFunction((index + i*Hash2), (*HT)->size);     //Aquí se aplica h2(i) = (x + f(i)) mod HASH_SIZE
     }
+    countProbes((*HT)->stats.insert_probes, i);
     return index;
 }
 
+/*Función para buscar un espacio con Robin Hood: el elemento nuevo se queda con la casilla de quien esté más cerca de
+ * su casilla original, y los desplazados se recorren hacia adelante con la misma regla*/
+//NOTA: Regresa la casilla para el elemento nuevo ya vacía; los elementos que se movieron actualizan su nodo del heap
+size_t RobinHood(HTable_OA **HT, size_t key){
+    hash_item *table = (*HT)->table;
+    hash_meta *meta = (*HT)->meta;
+    size_t size = (*HT)->size;
+    size_t index = hashFunction(key, size);
+    size_t dist = 0;
+    //Se avanza mientras los elementos encontrados estén igual o más lejos de su casilla original
+    while(meta[index].status==VALID && RHDisplacement(&meta[index], index, size) >= dist){
+        index = (index+1 == size) ? 0 : index+1;
+        dist++;
+    }
+    size_t slot = index;
+    if(meta[slot].status != VALID)
+        return slot;
+    //La casilla estaba ocupada por un elemento más cercano a su origen: se carga y se recorre hacia adelante
+    hash_item carry = table[slot];
+    hash_meta carryMeta = meta[slot];
+    meta[slot].status = NOTVALID;
+    dist = RHDisplacement(&carryMeta, slot, size);
+    index = slot;
+    while(1){
+        index = (index+1 == size) ? 0 : index+1;
+        dist++;
+        if(meta[index].status != VALID){
+            table[index] = carry;
+            meta[index] = carryMeta;
+            linkSlot(*HT, NO, index);
+            break;
+        }
+        size_t resident = RHDisplacement(&meta[index], index, size);
+        if(resident < dist){
+            hash_item aux = table[index];
+            hash_meta auxMeta = meta[index];
+            table[index] = carry;
+            meta[index] = carryMeta;
+            linkSlot(*HT, NO, index);
+            carry = aux;
+            carryMeta = auxMeta;
+            dist = resident;
+        }
+    }
+    return slot;
+}
+
+/*Función para quitar el elemento de una casilla con Robin Hood: los siguientes elementos de la cadena se recorren
+ * una casilla hacia atrás (no hacen falta marcas de borrado)*/
+void RHRemoveSlot(HTable_OA *HT, int old, size_t index){
+    hash_item *table = old ? HT->old_table : HT->table;
+    hash_meta *meta = old ? HT->old_meta : HT->meta;
+    size_t size = old ? HT->old_size : HT->size;
+    size_t next = (index+1 == size) ? 0 : index+1;
+    while(meta[next].status==VALID && RHDisplacement(&meta[next], next, size) > 0){
+        table[index] = table[next];
+        meta[index] = meta[next];
+        linkSlot(HT, old, index);
+        index = next;
+        next = (index+1 == size) ? 0 : index+1;
+    }
+    meta[index].status = NOTVALID;
+}
+
+/*Desplazamiento máximo de los elementos de una tabla Robin Hood (el peor caso de una búsqueda)*/
+size_t RHMaxDisplacement(HTable_OA *HT){
+    size_t max = 0;
+    for(size_t i=0; i<HT->size; i++){
+        if(HT->meta[i].status != VALID)
+            continue;
+        size_t d = RHDisplacement(&HT->meta[i], i, HT->size);
+        if(d > max)
+            max = d;
+    }
+    return max;
+}
+
+/*Función para buscar un espacio con los bytes de control (sondeo SW): la primera casilla vacía o borrada del
+ * recorrido por grupos. Su byte de control queda ya con el fragmento de la llave*/
+size_t SwissTable(HTable_OA **HT, hash_t key){
+    uint8_t *ctrl = (*HT)->ctrl;
+    size_t size = (*HT)->size;
+    size_t pos = hashFunction(key, size);
+    while(1){
+        uint32_t mask = ctrlFree(&ctrl[pos]);
+        if(mask){
+            size_t index = pos + __builtin_ctz(mask);
+            if(index >= size)
+                index -= size;
+            if(ctrl[index] == CTRL_DELETED)
+                (*HT)->tombstones--;
+            setCtrl(ctrl, size, index, ctrlHash(key));
+            return index;
+        }
+        pos += GROUP;
+        if(pos >= size)
+            pos -= size;
+    }
+}
+
+/*Función para buscar un espacio disponible según el tipo de sondeo elegido en MAIN*/
+size_t findFreeSlot(HTable_OA **HT, hash_t key, size_t mode){
+    switch (mode)
+    {
+    case LP:
+    case QP:
+        return LinearQuadraticProbing(HT, mode, key);
+    case DH:
+        return DoubleHashing(HT, key);
+    case RH:
+        return RobinHood(HT, key);
+    case SW:
+        return SwissTable(HT, key);
+    default:
+        break;
+    }
+    //Se realiza la función hash original
+    return hashFunction(key, (*HT)->size);
+}
+
 /*************************************************************************************************/
 
 /*Función para insertar un elemento en una tabla hash*/
 /*NOTA: la variable local "mode" es para indicar qué tipo de sonde se empleará*/
 hash_item* HTinsertRecord_OA(HTable_OA **HT, record *rec, int mode){
     //Primeramente vamos a ver si la tabla tiene un tamaño grande. Si es así, la expandemos
-    if(checkSizeOA(*HT, UP)==FULL){
-        (*HT)=RemodelHTableCap_OA(*HT, FULL, mode);
+    int state = checkSizeOA(*HT, UP);
+    if(state==FULL || state==DIRTY){
+        (*HT)=RemodelHTableCap_OA(*HT, state, mode);
     }
     //Se calcula la llave
-    uint32_t key = adler32(rec->bytes, rec->len);
+    hash_t key = hashRecord(*HT, rec);
     //Usando la función para encontrar una llave, se evalúa si lo que regresa es nulo o no (si no lo es, quiere decir que ya estaba el contenido...
     //... en la tabla)
     hash_item* item = HTfindRecord_OA(HT, rec, mode);
@@ -356,34 +1613,24 @@ hash_item* HTinsertRecord_OA(HTable_OA **HT, record *rec, int mode){
         return item;
     }
     //Si la ejecución llega hasta aquí, el contenido no estaba presente.
-    //Se realiza la función hash original
-    size_t index = hashFunction(key, (*HT)->size);
     //A continuación realizamos la búsqueda de un espacio disponible según el tipo de sondeo elegido en MAIN
-    switch (mode)
-    {
-    case DH:
-        index = DoubleHashing(HT, key);
-        break;
-    default:
-        break;
-    }
-    //Insertamos el record en el lugar encontrado
-    (*HT)->table[index].key = key;
-    (*HT)->table[index].status = VALID;
-    (*HT)->table[index].rec.bytes = malloc(sizeof(rec->len));
-    (*HT)->table[index].rec.len = rec->len;
-    if((*HT)->table[index].rec.bytes == NULL){
+    size_t index = findFreeSlot(HT, key, mode);
+    //Insertamos el record en el lugar encontrado (en modo numérico el entero va directo en el elemento; si no, la
+    //... llave se copia una sola vez a la arena)
+    if((*HT)->cfg.numeric)
+        memcpy(&(*HT)->table[index].num, rec->bytes, sizeof(int64_t));
+    else if(arenaIntern(&(*HT)->keys, rec, &(*HT)->table[index].ref) == NO){
         fprintf(stderr, "Cannot allocate memory for element!\n");
         return NULL;
     }
-    //Se copia el contenido
-    strcpy((*HT)->table[index].rec.bytes, rec->bytes);
+    (*HT)->meta[index].key = key;
+    (*HT)->meta[index].status = VALID;
     (*HT)->occupied_elements++;
     
     //Se guarda la ubicación (índice de tabla hash) en el elemento heap
     //OJO: Apenas se va insertar el elemento en el siguiente espacio del heap (por eso se le suma 1 al índice actual del heap)
-    (*HT)->h->array[(*HT)->h->index+1].hash_index = index; 
-    return (*HT)->table;
+    (*HT)->h->array[(*HT)->h->index+1].hash_index = tagIndex(*HT, index); 
+    return &(*HT)->table[index];
 }
 
 //Función para borrar un record en una tabla hash
@@ -393,21 +1640,45 @@ hash_item* HTdeleteRecordOA(HTable_OA **HT, record *rec, size_t mode){
     //Si el item no estaba simplemente se regresa su valor
     if(item == NULL)
         return item;
-    item ->status = NOTVALID;
-    item ->lazy_deleted = YES;
-    //Finalmente vamos a ver si la tabla tiene muchos elementos sin ocupar. Si es así, la reducimos
+    //Los bytes de la llave se quedan en la arena (el heap todavía los usa) hasta la siguiente compactación
+    if(!(*HT)->cfg.numeric)
+        arenaRelease(&(*HT)->keys, item->ref);
+    //Reducimos en uno su multiplicidad
+    (*HT)->h->array[item->heap_index].mult--;
+    //Reducimos en uno el número de elementos ocupados
+    if((*HT)->occupied_elements>0)
+    	(*HT)->occupied_elements--;
+    //Casilla del elemento (puede estar en la tabla anterior durante una migración)
+    int old = (*HT)->old_table != NULL && item >= (*HT)->old_table && item < (*HT)->old_table + (*HT)->old_size;
+    size_t index = item - (old ? (*HT)->old_table : (*HT)->table);
+    hash_meta *meta = old ? &(*HT)->old_meta[index] : &(*HT)->meta[index];
+    //Con Robin Hood la casilla se rellena con el resto de la cadena (OJO: "item" queda con otro elemento)
+    if(mode == RH){
+        RHRemoveSlot(*HT, old, index);
+        return item;
+    }
+    meta->status = NOTVALID;
+    meta->lazy_deleted = YES;
+    //Con sondeo SW la casilla se marca como borrada en los bytes de control
+    if(mode == SW){
+        if(old)
+            setCtrl((*HT)->old_ctrl, (*HT)->old_size, index, CTRL_DELETED);
+        else{
+            setCtrl((*HT)->ctrl, (*HT)->size, index, CTRL_DELETED);
+            (*HT)->tombstones++;
+        }
+    }
+    return item;
+}
+
+/*Función para reducir la tabla si tiene muchos elementos sin ocupar*/
+//NOTA: Se llama después de quitar el elemento también del heap (el remodelado sólo reacomoda elementos válidos)
+void shrinkHTable_OA(HTable_OA **HT, size_t mode){
     if(checkSizeOA(*HT, DOWN)==EMPTY){
         if((*HT)->index_size>0){
             (*HT)=RemodelHTableCap_OA(*HT, EMPTY, mode);
         }
     }
-    //Reducimos en uno el número de elementos ocupados
-    if((*HT)->occupied_elements>0)
-    	(*HT)->occupied_elements--;
-
-    //Reducimos en uno su multiplicidad
-    (*HT)->h->array[item->heap_index].mult--;
-    return item;
 }
 /****************************************HEAPS******************************************************************/
 //Comparador de records con valores negativos (rec compare)
@@ -415,11 +1686,15 @@ int reccmp_n(record r1, record r2){
     char *c1 = (char*) r1.bytes;
     char *c2 = (char*) r2.bytes;
     //Caso donde ambos contenidos son negativos. Aquí se invierten las reglas del comparador de records 
-    //... de num. positivos (si la primer cifra de A es mayor que la de B, entonces A es el menor)
+    //... de num. positivos (el que tenga más cifras es el menor y, con las mismas cifras, si la primer cifra
+    //... de A es mayor que la de B, entonces A es el menor)
     //NOTA: El signo negativo "-" es 45 en ASCII
     if(c1[0]==45 && c2[0]==45){
-        size_t len = r1.len < r2.len ? r1.len : r2.len;  //Si _____, entonces (?) ____. Si no (:), haz_________
-        for(size_t i = 0; i<len; i++){
+        if(r1.len > r2.len)
+            return -1;
+        if(r1.len < r2.len)
+            return 1;
+        for(size_t i = 1; i<r1.len; i++){
             if(c1[i] > c2[i]){
                 return -1;
             }
@@ -427,10 +1702,7 @@ int reccmp_n(record r1, record r2){
                 return 1;
             }
         }
-        if(r1.len > r2.len)
-            return -1;
-        if(r1.len > r2.len)
-            return 1;
+        return 0;
     }
     //Casos donde sólo un número es negativo
     if(c1[0]==45)
@@ -469,20 +1741,51 @@ int reccmp(record r1, record r2){
     return 0;
 }
 
-/*Regresa el papá de un nodo (se divide la posición entre dos que es lo mismo que hacer un recorrimiento a la derecha)*/
-static inline size_t parent(size_t pos){
-    return pos >> 1;
+/*Comparador de dos nodos del heap: en modo numérico es una sola comparación de enteros*/
+static inline int heapcmp(heap *h, heap_item *A, heap_item *B){
+    if(h->numeric)
+        return (A->num > B->num) - (A->num < B->num);
+    return reccmp(arenaView(h->keys, A->ref), arenaView(h->keys, B->ref));
+}
+
+/*Record con los bytes de la llave de un nodo (en modo numérico son los 8 bytes de "num")*/
+static inline record heapRecord(heap *h, heap_item *item){
+    record rec;
+    if(h->numeric){
+        rec.bytes = &item->num;
+        rec.len = sizeof(int64_t);
+        return rec;
+    }
+    return arenaView(h->keys, item->ref);
+}
+
+/*Función para escribir una llave (sin espacios); en modo numérico el record trae los 8 bytes del entero*/
+static inline void outRecord(out_buffer *out, heap *h, record *rec){
+    if(h->numeric){
+        int64_t num;
+        memcpy(&num, rec->bytes, sizeof(int64_t));
+        outInt(out, num);
+        return;
+    }
+    //Los bytes de la llave se copian de una vez
+    outWrite(out, rec->bytes, rec->len);
 }
 
-/*Regresa el hijo izquierdo de un nodo. Se multiplica por 2 (es lo mismo que hacer un recorrimiento a la izquierda)*/
-static inline size_t left_child(size_t pos){
-    return pos << 1;
+/*Función para escribir la llave de un nodo del heap (sin espacios)*/
+static inline void outKey(out_buffer *out, heap *h, heap_item *item){
+    record rec = heapRecord(h, item);
+    outRecord(out, h, &rec);
 }
 
+/*Regresa el papá de un nodo (la raíz está en 1). Con HEAP_ARITY = 2 es lo mismo que dividir la posición entre dos*/
+//NOTA: Como HEAP_ARITY es constante, el compilador cambia la división y la multiplicación por recorrimientos
+static inline size_t parent(size_t pos){
+    return (pos - 2)/HEAP_ARITY + 1;
+}
 
-/*Regresala el hijo derecho de un nodo. Se multiplica por 2 (es lo mismo que hacer un recorrimiento a la izquierda) y se suma 1*/
-static inline size_t right_child(size_t pos){
-    return (pos << 1) + 1;
+/*Regresa el primer hijo de un nodo; los demás están en las HEAP_ARITY-1 posiciones siguientes*/
+static inline size_t first_child(size_t pos){
+    return HEAP_ARITY*(pos - 1) + 2;
 }
 
 /*Función para heapify Up*/
@@ -492,384 +1795,2341 @@ void heapifyUp(heap **h, size_t index, HTable_OA **HT){
     size_t contador = 0;
     while(1){
         size_t parent_index = parent(index);
-        if(reccmp((*h)->array[index].rec, (*h)->array[parent_index].rec)==1){
-            multiplicidad = (*h)->array[index].mult;
+        //El ciclo se detiene en la raíz o cuando el nodo ya no es menor que su papá
+        if(index == 1 || heapcmp(*h, &(*h)->array[index], &(*h)->array[parent_index])!=-1){
             if(contador == 0)
-                 (*HT)->table[(*h)->array[index].hash_index].heap_index = (*HT)->h->index;
+                 heapSlot(*HT, (*h)->array[index].hash_index)->heap_index = index;
             break;
             }
         if(contador == 0)
-            (*HT)->table[(*h)->array[index].hash_index].heap_index = (*HT)->h->index;
+            heapSlot(*HT, (*h)->array[index].hash_index)->heap_index = index;
         heap_item aux = (*h)->array[index];      //Aquí empleamos una variable auxiliar
         
-        //A continuación se hace el SWAP
-        (*h)->array[index].rec = (*h)->array[parent_index].rec;
-        (*h)->array[index].mult = (*h)->array[parent_index].mult;
-        //Aquí también se hace SWAP ente las ubicaciones (índices) del elemento en el heap presentes en los respectivos elementos hash
-        (*HT)->table[(*h)->array[index].hash_index].heap_index = parent_index;
-        (*h)->array[index].hash_index = (*h)->array[parent_index].hash_index;
-        
-        (*h)->array[parent_index].rec = aux.rec;
-        (*h)->array[parent_index].mult = aux.mult;
-        //Aquí también se hace SWIMP ente las ubicaciones (índices) del elemento en el heap presentes en los respectivos elementos hash
-        (*HT)->table[(*h)->array[parent_index].hash_index].heap_index = index;
-        (*h)->array[parent_index].hash_index = aux.hash_index;
+        //A continuación se hace el SWAP (de nodos completos)
+        (*h)->array[index] = (*h)->array[parent_index];
+        (*h)->array[parent_index] = aux;
+        //Aquí también se actualizan las ubicaciones (índices) del elemento en el heap presentes en los respectivos elementos hash
+        heapSlot(*HT, (*h)->array[index].hash_index)->heap_index = index;
+        heapSlot(*HT, (*h)->array[parent_index].hash_index)->heap_index = parent_index;
         
         index = parent_index;
         contador++;
     }
+    (*HT)->stats.swaps_up += contador;
     return;
 }
 
 void heapifyDown(heap **H, size_t index, HTable_OA **HT){
     heap *h = *H;
+    size_t swaps = 0;
     //El siguiente While se rompe cuando llegamos a la generación donde se cumple la condición Heap dado un elemento inicial (siempre que)
     //el nodo de interés sea menor a los hijos
+    //NOTA: Las casillas después de h->index no están inicializadas: los hijos se comparan sólo si existen
     while(1){
-        size_t left = left_child(index);
-        size_t right = right_child(index);
-        if((reccmp(h->array[index].rec, h->array[left].rec)==-1) && (reccmp(h->array[index].rec, h->array[right].rec)==-1)){
-            size_t prueba = h->array[index].mult;
+        size_t first = first_child(index);
+        //Si no tiene hijos, ya es una hoja
+        if(first > h->index)
             break;
-        }
-        //A continuación se hace el SWAP con el hijo menor
-        size_t min_index;
-        if(reccmp(h->array[left].rec, h->array[right].rec)==-1){
-            min_index = left;
+        //Se elige al hijo menor. Si el nodo tiene todos sus hijos el ciclo es de tamaño fijo (el compilador lo desenrolla);
+        //... si no, sólo se revisan los que existen
+        size_t min_index = first;
+        if(first + HEAP_ARITY - 1 <= h->index){
+            for(size_t k=1; k<HEAP_ARITY; k++)
+                if(heapcmp(h, &h->array[first+k], &h->array[min_index])==-1)
+                    min_index = first+k;
         }
         else{
-            min_index = right;
+            for(size_t child=first+1; child<=h->index; child++)
+                if(heapcmp(h, &h->array[child], &h->array[min_index])==-1)
+                    min_index = child;
+        }
+        //Si el nodo no es mayor que su hijo menor, se cumple la condición Heap
+        if(heapcmp(h, &h->array[index], &h->array[min_index])!=1){
+            break;
         }
+        //A continuación se hace el SWAP con el hijo menor
         heap_item aux = h->array[index];
-        h->array[index].rec = h->array[min_index].rec;
-        h->array[index].mult = h->array[min_index].mult;
-        //Aquí también se hace SWAP ente las ubicaciones (índices) del elemento en el heap presentes en los respectivos elementos hash
-        (*HT)->table[h->array[index].hash_index].heap_index = min_index;
-        h->array[index].hash_index = h->array[min_index].hash_index;
-
-        h->array[min_index].rec = aux.rec;
-        h->array[min_index].mult = aux.mult;
-        //Aquí también se hace SWAP ente las ubicaciones (índices) del elemento en el heap presentes en los respectivos elementos hash
-        (*HT)->table[h->array[min_index].hash_index].heap_index = index;
-        h->array[min_index].hash_index = aux.hash_index;
+        h->array[index] = h->array[min_index];
+        h->array[min_index] = aux;
+        //Aquí también se actualizan las ubicaciones (índices) del elemento en el heap presentes en los respectivos elementos hash
+        heapSlot(*HT, h->array[index].hash_index)->heap_index = index;
+        heapSlot(*HT, h->array[min_index].hash_index)->heap_index = min_index;
         
         index = min_index;
+        swaps++;
     }
+    (*HT)->stats.swaps_down += swaps;
     return;
 }
 
 /*Generador de una estructura Heap*/
-heap* newHeapCap(size_t cap){
+heap* newHeapCap(size_t cap, int numeric, int huge, int engine, key_arena *keys){
     heap *new_heap = (heap*)malloc(sizeof(heap)*1); 
     if(new_heap == NULL){
         fprintf(stderr, "Error en malloc!\n");
         exit(1);
     }
-    new_heap->array = (heap_item*)malloc(sizeof(heap_item)*cap);
+    new_heap->array = (heap_item*)allocBlock(sizeof(heap_item)*cap, huge, NO);
     if(new_heap->array == NULL){
         fprintf(stderr, "Error en malloc!\n");
         exit(1);
     }
     new_heap->cap = cap;
     new_heap->index = 0;            //Colocamos el índice en 0 (porque vamos a empezar a ingresar elementos desde el 1)
-    new_heap->array[0].rec.bytes = INF_N;     //Inicializamos la raíz con infinito negativo (el número menor posible)
-    new_heap->array[0].rec.len = strlen(INF_N);
-    for(size_t i=1; i<cap; i++){
-        new_heap->array[i].rec.bytes = (void*)malloc(sizeof(INF_P));
-        new_heap->array[i].rec.bytes = INF_P; //Inicializamos los hijos con infinito positivo (el número mayor posible)
-        new_heap->array[i].rec.len = strlen(INF_P);
-        new_heap->array[i].mult = 1;           //Iniciamos la multiplicidad de cada caso en 1
+    new_heap->numeric = numeric;
+    new_heap->keys = keys;
+    new_heap->mapped = NO;
+    new_heap->huge = huge;
+    new_heap->engine = engine;
+    //Motor radix: todas las cubetas vacías y "last" en la menor llave posible
+    new_heap->last = 0;
+    new_heap->occupied = 0;
+    memset(new_heap->bucket, 0, sizeof(new_heap->bucket));
+    new_heap->link = NULL;
+    if(engine == ENGINE_RADIX){
+        new_heap->link = (uint64_t*)malloc(sizeof(uint64_t)*cap);
+        if(new_heap->link == NULL){
+            fprintf(stderr, "Error en malloc!\n");
+            exit(1);
+        }
     }
+    //NOTA: Las casillas no se inicializan: cada nodo se llena al insertarse y nunca se leen las que pasan de "index"
     return new_heap;
 }
 
 /*Función para generar un Heap de 1024 elementos*/
-heap* newHeap(){
-    return newHeapCap(1024);
+heap* newHeap(int numeric, int huge, int engine, key_arena *keys){
+    return newHeapCap(1024, numeric, huge, engine, keys);
+}
+
+/*Libera las cubetas del motor radix*/
+static void freeRadix(heap *h){
+    for(size_t b=0; b<RADIX_BUCKETS; b++)
+        free(h->bucket[b].nodes);
+    memset(h->bucket, 0, sizeof(h->bucket));
+    h->occupied = 0;
+    free(h->link);
+    h->link = NULL;
 }
 
 /*Función para liberar espacio de memoria ocupada por un heap*/
 void freeHeap(heap *h){
-    free(h->array);
+    //Las llaves no son del heap (están en la arena de la tabla)
+    releaseBlock(h->array, sizeof(heap_item)*h->cap, h->mapped, h->huge);
+    freeRadix(h);
     free(h);
 }
 
-/*Prototipo para insert*/
-void insertHeap(record *rec, heap **h, HTable_OA **HT);
+/*Función para expandir un heap: duplica la capacidad del arreglo sin mover los nodos de lugar*/
+//NOTA: realloc (o la copia, con páginas grandes) conserva el orden del arreglo, así que no hace falta volver a
+//... acomodar el heap (ni tocar la tabla)
+void RemodelHeap(heap *h){
+    heap_item *array = (heap_item*)growBlock(h->array, sizeof(heap_item)*h->cap, sizeof(heap_item)*h->cap*2,
+                                             &h->mapped, h->huge);
+    if(array == NULL){
+        fprintf(stderr, "Error en malloc!\n");
+        exit(1);
+    }
+    h->array = array;
+    h->cap = h->cap*2;
+    //Con el motor radix, la cubeta de cada nodo crece junto con el arreglo
+    if(h->engine == ENGINE_RADIX){
+        uint64_t *link = (uint64_t*)realloc(h->link, sizeof(uint64_t)*h->cap);
+        if(link == NULL){
+            fprintf(stderr, "Error en malloc!\n");
+            exit(1);
+        }
+        h->link = link;
+    }
+}
+
+/*RemodelHeap con su registro en las estadísticas del quash*/
+static inline void growHeap(HTable_OA *HT, heap *h){
+    uint64_t start = statsClock();
+    RemodelHeap(h);
+    HT->stats.heap_grows++;
+    HT->stats.heap_grow_ns += statsClock() - start;
+}
+
+/************************MOTOR RADIX***************************************/
+/*Llave de un nodo como entero sin signo con el mismo orden (se invierte el bit de signo)*/
+static inline uint64_t radixKey(heap_item *item){
+    return (uint64_t)item->num ^ ((uint64_t)1 << 63);
+}
+
+/*Cubeta de una llave: 0 si es igual a "last"; si no, 1 + el bit más alto en que difieren*/
+static inline size_t radixBucketOf(uint64_t key, uint64_t last){
+    uint64_t diff = key ^ last;
+    return diff ? 64 - __builtin_clzll(diff) : 0;
+}
+
+/*Agrega el nodo "node" al final de la cubeta "b"*/
+static inline void radixPush(heap *h, size_t node, size_t b){
+    radix_bucket *B = &h->bucket[b];
+    if(B->len == B->cap){
+        size_t cap = B->cap ? B->cap*2 : 16;
+        size_t *nodes = (size_t*)realloc(B->nodes, sizeof(size_t)*cap);
+        if(nodes == NULL){
+            fprintf(stderr, "Error en malloc!\n");
+            exit(1);
+        }
+        B->nodes = nodes;
+        B->cap = cap;
+    }
+    h->link[node] = ((uint64_t)b << RADIX_POS_BITS) | B->len;
+    B->nodes[B->len++] = node;
+    if(b > 0)
+        h->occupied |= (uint64_t)1 << (b - 1);
+}
+
+/*Quita un nodo de su cubeta: el último de la cubeta ocupa su lugar*/
+static inline void radixUnlink(heap *h, size_t node){
+    size_t b = h->link[node] >> RADIX_POS_BITS;
+    size_t pos = h->link[node] & (((uint64_t)1 << RADIX_POS_BITS) - 1);
+    radix_bucket *B = &h->bucket[b];
+    size_t moved = B->nodes[--B->len];
+    B->nodes[pos] = moved;
+    h->link[moved] = ((uint64_t)b << RADIX_POS_BITS) | pos;
+    if(B->len == 0 && b > 0)
+        h->occupied &= ~((uint64_t)1 << (b - 1));
+}
+
+/*Vuelve a repartir todos los nodos con un nuevo "last" (que no debe ser mayor a ninguna llave)*/
+void radixRebuild(heap *h, uint64_t last){
+    for(size_t b=0; b<RADIX_BUCKETS; b++)
+        h->bucket[b].len = 0;
+    h->occupied = 0;
+    h->last = last;
+    for(size_t i=1; i<=h->index; i++)
+        radixPush(h, i, radixBucketOf(radixKey(&h->array[i]), last));
+}
+
+/*Coloca en su cubeta el nodo "node" (ya escrito en el arreglo)*/
+//NOTA: Una llave menor a "last" rompe el orden de las cubetas: se reparten todas otra vez con esa llave como "last"
+//... (O(n)). Con mínimos que no decrecen nunca pasa
+void radixInsert(HTable_OA *HT, heap *h, size_t node){
+    uint64_t key = radixKey(&h->array[node]);
+    if(key < h->last){
+        HT->stats.radix_rebuilds++;
+        radixRebuild(h, key);
+        return;
+    }
+    radixPush(h, node, radixBucketOf(key, h->last));
+}
 
-/*Función para expandir un heap (crear un heap con una mayor extención para ahí colocar un )*/
-heap* RemodelHeap(heap *previousHeap, HTable_OA **HT){
-    //Se incrementa el espacio por el doble del tamaño anterior
-    heap *h = newHeapCap(previousHeap->cap*2);
-    size_t index = previousHeap->index;
-    //Se inserta el contenido del heap anterior al nuevo
-    for(size_t i=1; i<=index; i++){
-        insertHeap(&previousHeap->array[i].rec, &h, HT);
+/*Posición en el arreglo del nodo mínimo (0 si no hay nodos)*/
+//NOTA: Si la cubeta 0 está vacía, se toma la primera cubeta con nodos, su menor llave pasa a ser "last" y sus nodos
+//... se reparten en cubetas menores (el mínimo queda solo en la cubeta 0). No se compara ninguna llave con reccmp
+//... ni se mueve ningún nodo del arreglo: la tabla no se toca
+size_t radixTop(HTable_OA *HT, heap *h){
+    if(h->index == 0)
+        return 0;
+    if(h->bucket[0].len > 0)
+        return h->bucket[0].nodes[0];
+    size_t b = __builtin_ctzll(h->occupied) + 1;
+    radix_bucket *B = &h->bucket[b];
+    uint64_t min = radixKey(&h->array[B->nodes[0]]);
+    for(size_t i=1; i<B->len; i++){
+        uint64_t key = radixKey(&h->array[B->nodes[i]]);
+        if(key < min)
+            min = key;
     }
-    //Se libera el heap anterior
-    freeHeap(previousHeap);
-    return h;
+    //Cada nodo de la cubeta cae en una cubeta menor, así que se puede recorrer mientras se reparte
+    size_t len = B->len;
+    B->len = 0;
+    h->occupied &= ~((uint64_t)1 << (b - 1));
+    h->last = min;
+    for(size_t i=0; i<len; i++)
+        radixPush(h, B->nodes[i], radixBucketOf(radixKey(&h->array[B->nodes[i]]), min));
+    HT->stats.radix_moves += len;
+    return h->bucket[0].nodes[0];
 }
 
-/*Función para insertar un nodo en el Heap. Recuerda que "**" es la dirección de la dirección*/
-void insertHeap(record *rec, heap **h, HTable_OA **HT){
-    //Aquí se evaluará si aún hay espacio para introducir un nuevo elemento. Si no, hay que incrementarlo
-    if((*h)->index == (*h)->cap-1){
-        *h = RemodelHeap((*HT)->h, HT);
+/*Quita del heap el nodo "node": el último nodo del arreglo ocupa su lugar (se actualizan su cubeta y su casilla)*/
+void radixRemove(HTable_OA *HT, heap *h, size_t node){
+    radixUnlink(h, node);
+    size_t last = h->index;
+    if(node < last){
+        h->array[node] = h->array[last];
+        heapSlot(HT, h->array[node].hash_index)->heap_index = node;
+        h->link[node] = h->link[last];
+        h->bucket[h->link[node] >> RADIX_POS_BITS].nodes[h->link[node] & (((uint64_t)1 << RADIX_POS_BITS) - 1)] = node;
     }
+    h->index--;
+    //Sin nodos, cualquier llave puede entrar sin repartir de nuevo
+    if(h->index == 0)
+        h->last = 0;
+}
+
+/*Posición del nodo mínimo del quash (la raíz con el heap; con el motor radix, la de la cubeta 0)*/
+static inline size_t heapTop(HTable_OA *HT){
+    if(HT->h->engine == ENGINE_RADIX)
+        return radixTop(HT, HT->h);
+    return 1;
+}
+
+/*Función para insertar un nodo en el Heap. Recuerda que "**" es la dirección de la dirección*/
+//NOTA: "ref" es el mismo que guarda el elemento de la tabla (en modo numérico, los bits del entero)
+void insertHeap(uint64_t ref, heap **h, HTable_OA **HT){
     heap *H = *h; 
-    //Se inserta el elemento según el orden de un Heap
-    H->array[H->index+1].rec.bytes = (void*)malloc(sizeof(rec->len));
-    memcpy(H->array[H->index+1].rec.bytes, rec->bytes, strlen(rec->bytes));
-    size_t longitud = rec->len;
-    H->array[H->index+1].rec.len = longitud;
+    //Se inserta el elemento según el orden de un Heap (sin copiar la llave: sólo su ref)
+    H->array[H->index+1].ref = ref;
     
-    (*HT)->h->index = (*HT)->h->index+1;
-    heapifyUp(&H, H->index, HT);             //Se realiza el proceso de Heapify Up
+    H->index = H->index+1;
+    //Con el motor radix sólo se coloca en su cubeta (el nodo se queda al final del arreglo)
+    if(H->engine == ENGINE_RADIX){
+        heapSlot(*HT, H->array[H->index].hash_index)->heap_index = H->index;
+        radixInsert(*HT, H, H->index);
+    }
+    else
+        heapifyUp(&H, H->index, HT);             //Se realiza el proceso de Heapify Up
+    //Siempre debe quedar libre la casilla siguiente (la tabla y InsertElement la preparan antes de insertar). Si ya
+    //... no hay, se incrementa el espacio
+    if(H->index == H->cap-1){
+        growHeap(*HT, H);
+    }
 }
 
 /*Función para borrar el elemento más chico del Heap (la raíz)*/
 void deleteMin(HTable_OA **HT){
+    //En modo incremental, cada operación muda un tramo de la tabla anterior
+    migrateStep(*HT, MIGRATE_STEP, (*HT)->cfg.probing);
     heap *H = (*HT)->h;
+    out_buffer *out = &(*HT)->out;
+    int verbose = (*HT)->cfg.output == OUT_VERBOSE;
     //Si el índice del Heap está en 0, quiere decir que no hay un elemento mínimo presente
     if(H->index==0){
-        printf("elemento minimo no presente (tabla esta vacia)");
+        out->count.min_empty++;
+        if(verbose)
+            outText(out, "elemento minimo no presente (tabla esta vacia)");
         return;
     }
+    //Posición del mínimo (la raíz, salvo con el motor radix)
+    size_t top = heapTop(*HT);
     //Se verifica ahora si el elemento mínimo del heap tiene multiplicidad > 1
-    if(H->array[1].mult>1){
+    if(H->array[top].mult>1){
         //Si es el caso que la multiplicidad es mayor a 0, sólo se decrementa en 1
-        H->array[1].mult--;
+        H->array[top].mult--;
+        out->count.min_decremented++;
         //Impresión en pantalla
-        char *str = (char*)H->array[1].rec.bytes;
-        printf("elemento minimo ");
-        for(size_t j=0; j<H->array[1].rec.len; j++){
-                printf("%c", str[j]);
-            }
-        printf(" se decremento, nuevo contador = %ld\n", H->array[1].mult);
+        if(verbose){
+            outText(out, "elemento minimo ");
+            outKey(out, H, &H->array[top]);
+            outText(out, " se decremento, nuevo contador = ");
+            outUInt(out, H->array[top].mult);
+            outWrite(out, "\n", 1);
+        }
         return;
     }
     //Borramos en la hash table
-    HTdeleteRecordOA(HT, &H->array[1].rec, DH);
+    record min = heapRecord(H, &H->array[top]);
+    HTdeleteRecordOA(HT, &min, (*HT)->cfg.probing);
+    out->count.min_deleted++;
     //Impresión en pantalla
-    char *str = (char*)H->array[1].rec.bytes;
-    printf("elemento minimo ");
-    for(size_t j=0; j<H->array[1].rec.len; j++){
-            printf("%c", str[j]);
-        }
-    printf(" eliminado\n");
-    //Swap del último elemento insertado con la raíz del heap. "Borramos" a la raiz (asignamos el valor INF_P)
-    size_t ubication = 1;
+    if(verbose){
+        outText(out, "elemento minimo ");
+        outKey(out, H, &H->array[top]);
+        outText(out, " eliminado\n");
+    }
+    //Con el motor radix basta con quitar el nodo de su cubeta
+    if(H->engine == ENGINE_RADIX){
+        radixRemove(*HT, H, top);
+        shrinkHTable_OA(HT, (*HT)->cfg.probing);
+        return;
+    }
+    //Se mueve el último elemento insertado a la raíz del heap y se acorta el heap
     size_t LastIndex = H->index;
-    size_t pruebaUb = (*HT)->table[H->array[ubication].hash_index].heap_index;
-    size_t pruebaI = (*HT)->table[H->array[LastIndex].hash_index].heap_index;
-    heap_item aux = H->array[ubication];
-
-    H->array[ubication].rec = H->array[LastIndex].rec;
-    H->array[ubication].mult = H->array[LastIndex].mult;
-    (*HT)->table[H->array[ubication].hash_index].heap_index = LastIndex;
-    H->array[ubication].hash_index = H->array[LastIndex].hash_index;
-    
-    H->array[LastIndex].rec.bytes = INF_P;
-    H->array[LastIndex].mult = aux.mult;
-    (*HT)->table[H->array[LastIndex].hash_index].heap_index = ubication;
-    H->array[LastIndex].hash_index = aux.hash_index;
-    
-    pruebaUb = (*HT)->table[H->array[ubication].hash_index].heap_index;
-    pruebaI = (*HT)->table[H->array[LastIndex].hash_index].heap_index;
+    H->array[1] = H->array[LastIndex];
+    heapSlot(*HT, H->array[1].hash_index)->heap_index = 1;
+    H->index--;
 
     //Hacemos heapifyDown
     heapifyDown(&H, 1, HT);
-    H->index--;
+    //Ya sin el elemento en el heap, se revisa si conviene reducir la tabla
+    shrinkHTable_OA(HT, (*HT)->cfg.probing);
     return;
 }
 
+/*Elemento que regresa popK: copia del nodo (con "mult" = lo que le queda en el quash, 0 si se eliminó) y cuántas
+ * veces se sacó*/
+typedef struct {
+    heap_item node;
+    size_t taken;
+} pop_item;
+
+/*Heap auxiliar de candidatos (índices del heap principal) para recorrer los menores en orden*/
+static inline void candPush(heap *H, size_t *cand, size_t *n, size_t index){
+    size_t pos = (*n)++;
+    while(pos > 0 && heapcmp(H, &H->array[index], &H->array[cand[(pos-1)/2]])==-1){
+        cand[pos] = cand[(pos-1)/2];
+        pos = (pos-1)/2;
+    }
+    cand[pos] = index;
+}
+
+static inline size_t candPop(heap *H, size_t *cand, size_t *n){
+    size_t top = cand[0], last = cand[--(*n)], pos = 0;
+    while(2*pos+1 < *n){
+        size_t child = 2*pos+1;
+        if(child+1 < *n && heapcmp(H, &H->array[cand[child+1]], &H->array[cand[child]])==-1)
+            child++;
+        if(heapcmp(H, &H->array[last], &H->array[cand[child]])!=1)
+            break;
+        cand[pos] = cand[child];
+        pos = child;
+    }
+    cand[pos] = last;
+    return top;
+}
+
+static int cmpIndex(const void *a, const void *b){
+    size_t x = *(const size_t*)a, y = *(const size_t*)b;
+    return (x > y) - (x < y);
+}
+
+/*Función para sacar de una vez los k menores (contando multiplicidad, igual que k llamadas a deleteMin). Escribe en
+ * "out" cada llave distinta en orden y regresa cuántas son ("out" debe tener lugar para min(k, h->index))*/
+//NOTA: Los menores del heap forman un subárbol que contiene a la raíz, así que se encuentran con un heap auxiliar de
+//... candidatos sin mover nada. Luego los huecos se llenan con los últimos nodos y se reparan con heapifyDown del
+//... más profundo al más alto (como en Floyd): una sola reparación para todo el lote
+//OJO: No se revisa el tamaño de la tabla (las llaves de "out" siguen en la arena); el llamador usa shrinkHTable_OA
+//... una sola vez después de leerlas
+size_t popK(HTable_OA **HT, size_t k, pop_item *out){
+    migrateStep(*HT, MIGRATE_STEP, (*HT)->cfg.probing);
+    heap *H = (*HT)->h;
+    if(H->index == 0 || k == 0)
+        return 0;
+    //Con el motor radix los menores salen uno por uno de la cubeta 0 (no hay árbol que recorrer)
+    if(H->engine == ENGINE_RADIX){
+        size_t count = 0, left = k;
+        while(left > 0 && H->index > 0){
+            size_t top = radixTop(*HT, H);
+            size_t taken = (H->array[top].mult < left) ? H->array[top].mult : left;
+            left -= taken;
+            out[count].node = H->array[top];
+            out[count].node.mult -= taken;
+            out[count++].taken = taken;
+            if(H->array[top].mult > taken){
+                H->array[top].mult -= taken;
+                break;
+            }
+            record rec = heapRecord(H, &H->array[top]);
+            HTdeleteRecordOA(HT, &rec, (*HT)->cfg.probing);
+            radixRemove(*HT, H, top);
+        }
+        return count;
+    }
+    size_t limit = (k < H->index) ? k : H->index;
+    size_t *cand = (size_t*)malloc(sizeof(size_t)*(limit*HEAP_ARITY + 1));
+    size_t *holes = (size_t*)malloc(sizeof(size_t)*limit);
+    if(cand == NULL || holes == NULL){
+        fprintf(stderr, "Error en malloc!\n");
+        exit(1);
+    }
+    //Se recorren los nodos en orden hasta juntar k (el último puede quedarse con parte de su multiplicidad)
+    size_t ncand = 0, count = 0, left = k;
+    candPush(H, cand, &ncand, 1);
+    while(left > 0 && ncand > 0){
+        size_t index = candPop(H, cand, &ncand);
+        size_t taken = (H->array[index].mult < left) ? H->array[index].mult : left;
+        left -= taken;
+        out[count].node = H->array[index];
+        out[count].node.mult -= taken;
+        out[count].taken = taken;
+        holes[count++] = index;
+        size_t first = first_child(index);
+        for(size_t child=first; child<first+HEAP_ARITY && child<=H->index; child++)
+            candPush(H, cand, &ncand, child);
+    }
+    size_t removed = count;
+    if(out[count-1].node.mult > 0){
+        H->array[holes[count-1]].mult = out[count-1].node.mult;
+        removed--;
+    }
+    //Se borran de la tabla hash (los nodos siguen en el heap, así que los sondeos que mueven casillas los actualizan)
+    for(size_t i=0; i<removed; i++){
+        record rec = heapRecord(H, &H->array[holes[i]]);
+        HTdeleteRecordOA(HT, &rec, (*HT)->cfg.probing);
+    }
+    //Los huecos se marcan con multiplicidad 0 y los que quedan dentro del nuevo tamaño se llenan con los últimos nodos
+    for(size_t i=0; i<removed; i++)
+        H->array[holes[i]].mult = 0;
+    qsort(holes, removed, sizeof(size_t), cmpIndex);
+    size_t size = H->index - removed, last = H->index, filled = 0;
+    while(filled < removed && holes[filled] <= size){
+        while(H->array[last].mult == 0)
+            last--;
+        H->array[holes[filled]] = H->array[last--];
+        heapSlot(*HT, H->array[holes[filled]].hash_index)->heap_index = holes[filled];
+        filled++;
+    }
+    H->index = size;
+    for(size_t i=filled; i>0; i--)
+        heapifyDown(&H, holes[i-1], HT);
+    free(holes);
+    free(cand);
+    return count;
+}
+
+/*Función para borrar los k elementos más chicos (comando "deleteMin k")*/
+void deleteMinK(HTable_OA **HT, size_t k){
+    heap *H = (*HT)->h;
+    size_t limit = (k < H->index) ? k : H->index;
+    pop_item *out = (pop_item*)malloc(sizeof(pop_item)*(limit + 1));
+    if(out == NULL){
+        fprintf(stderr, "Error en malloc!\n");
+        exit(1);
+    }
+    size_t count = popK(HT, k, out);
+    out_buffer *o = &(*HT)->out;
+    int verbose = (*HT)->cfg.output == OUT_VERBOSE;
+    if(count == 0 && k > 0){
+        o->count.min_empty++;
+        if(verbose)
+            outText(o, "elemento minimo no presente (tabla esta vacia)");
+    }
+    for(size_t i=0; i<count; i++){
+        if(out[i].node.mult > 0)
+            o->count.min_decremented++;
+        else
+            o->count.min_deleted++;
+        if(!verbose)
+            continue;
+        outText(o, "elemento minimo ");
+        outKey(o, (*HT)->h, &out[i].node);
+        if(out[i].node.mult > 0){
+            outText(o, " se decremento, nuevo contador = ");
+            outUInt(o, out[i].node.mult);
+        }
+        else{
+            outText(o, " eliminado, contador = ");
+            outUInt(o, out[i].taken);
+        }
+        outWrite(o, "\n", 1);
+    }
+    free(out);
+    //Una sola revisión del tamaño de la tabla para todo el lote
+    shrinkHTable_OA(HT, (*HT)->cfg.probing);
+}
+
 /*Función para borrar un elemento del Heap conociendo el índice correspondiente (variable "ubication")*/
 void deleteHeap(heap **h, size_t ubication, HTable_OA **HT){
     heap *H = *h;
-    //Swap del último elemento insertado con la raíz. "Borramos" a al elemento de interés (asignamos el valor INF_P)
+    if(H->engine == ENGINE_RADIX){
+        radixRemove(*HT, H, ubication);
+        return;
+    }
+    //Se mueve el último elemento insertado al lugar de interés y se acorta el heap
     size_t LastIndex = H->index;
-    size_t pruebaUb = (*HT)->table[H->array[ubication].hash_index].heap_index;
-    size_t pruebaI = (*HT)->table[H->array[LastIndex].hash_index].heap_index;
-    heap_item aux = H->array[ubication];
-    H->array[ubication].rec = H->array[LastIndex].rec;
-    H->array[ubication].mult = H->array[LastIndex].mult;
-    (*HT)->table[H->array[ubication].hash_index].heap_index = LastIndex;
-    H->array[ubication].hash_index = H->array[LastIndex].hash_index;
-    
-    H->array[LastIndex].rec.bytes = INF_P;
-    H->array[LastIndex].mult = aux.mult;
-    (*HT)->table[H->array[LastIndex].hash_index].heap_index = ubication;
-    H->array[LastIndex].hash_index = aux.hash_index;
-    
-    pruebaUb = (*HT)->table[H->array[ubication].hash_index].heap_index;
-    pruebaI = (*HT)->table[H->array[LastIndex].hash_index].heap_index;
-
-    //Hacemos heapifyDown
-    heapifyDown(h, ubication, HT);
+    if(ubication < LastIndex){
+        H->array[ubication] = H->array[LastIndex];
+        heapSlot(*HT, H->array[ubication].hash_index)->heap_index = ubication;
+    }
     //Decrementamos el índice (procurando que nunca sea menor a 0)
     if(H->index > 0)
         H->index--;
+    if(ubication > H->index)
+        return;
+    //El elemento que llegó puede ser menor que su nuevo papá (heapifyUp) o mayor que sus hijos (heapifyDown)
+    if(ubication > 1 && heapcmp(H, &H->array[ubication], &H->array[parent(ubication)])==-1)
+        heapifyUp(h, ubication, HT);
+    else
+        heapifyDown(h, ubication, HT);
     return;
 }
 
-void printElement(heap_item *item){
-    char *str = (char*)item->rec.bytes;
-    str = item->rec.bytes;
-    for(size_t j=0; j<item->rec.len; j++){
-        printf("%c", str[j]);
-    }
-    printf(" ");
+void printElement(out_buffer *out, heap *h, heap_item *item){
+    outKey(out, h, item);
+    outWrite(out, " ", 1);
 }
 
 /*Función para imprimir un heap*/
 void print_Heap(HTable_OA *H){
+    if(H->cfg.output != OUT_VERBOSE)
+        return;
     heap *h = H->h;
     for(size_t i=1; i<=h->index; i++){
-        char *str = (char*)h->array[i].rec.bytes;
-        for(size_t j=0; j<h->array[i].rec.len; j++){
-            printf("%c", str[j]);
-        }
-        printf(" ");
+        printElement(&H->out, h, &h->array[i]);
     }
-    printf("\n");
+    outWrite(&H->out, "\n", 1);
     }
 
 /**************************Funciones para quash*********************************************/
 /*Función para verificar si está insertado un elemento (e indicar su multiplicidad)*/
 void LookUpElement(HTable_OA **HT, record *rec){
-    hash_item *aux = HTfindRecord_OA(HT, rec, DH);
+    //En modo incremental, cada operación muda un tramo de la tabla anterior
+    migrateStep(*HT, MIGRATE_STEP, (*HT)->cfg.probing);
+    hash_item *aux = HTfindRecord_OA(HT, rec, (*HT)->cfg.probing);
+    out_buffer *out = &(*HT)->out;
+    int verbose = (*HT)->cfg.output == OUT_VERBOSE;
     //Se verifica que el hash item correspondiente exista y esté marcado como válido (no borrado)
-    if(aux != NULL && aux->status==VALID){
+    if(aux != NULL){
         size_t contador = (*HT)->h->array[aux->heap_index].mult;
-        printf("elemento encontrado, contador = %ld\n", contador);
+        out->count.found++;
+        if(verbose){
+            outText(out, "elemento encontrado, contador = ");
+            outUInt(out, contador);
+            outWrite(out, "\n", 1);
+        }
     }
     else{
-        printf("elemento no encontrado\n");
+        out->count.not_found++;
+        if(verbose)
+            outText(out, "elemento no encontrado\n");
     }
 }
 
+/*Función para insertar un record (sin imprimir). Regresa su multiplicidad después de insertarlo*/
+size_t quashInsert(HTable_OA **HT, record *rec){
+    //En modo incremental, cada operación muda un tramo de la tabla anterior
+    migrateStep(*HT, MIGRATE_STEP, (*HT)->cfg.probing);
+    //Se verifica si ya estaba el record
+    hash_item *aux = HTfindRecord_OA(HT, rec, (*HT)->cfg.probing);
+    //Si ya estaba, sólo se aumenta en uno el valor de su multiplicidad
+    if(aux!=NULL)
+        return ++(*HT)->h->array[aux->heap_index].mult;
+    //Si no estaba, se inserta en la tabla hash y se guarda su ubicación (en el heap) en el hash item correspondiente
+    aux = HTinsertRecord_OA(HT, rec, (*HT)->cfg.probing);
+    //OJO: Como apenas se va a insertar en el heap, se suma 1 al índice
+    aux->heap_index = (*HT)->h->index+1;
+    //Se inserta en el Heap
+    (*HT)->h->array[aux->heap_index].mult = 1;
+    insertHeap(aux->ref, &(*HT)->h, HT);
+    return 1;
+}
+
 /*Función para insertar un elemento*/
 void InsertElement(HTable_OA **HT, record *rec){
-    //Prueba
-    unsigned char *A = (unsigned char*)(*HT)->h->array[(*HT)->h->index].rec.bytes;
-    unsigned char *pA = (unsigned char*)rec->bytes;
-    char *str = (char*)(*HT)->h->array[5].rec.bytes;
-    //Se verifica si ya estaba el record
-    hash_item *aux = HTfindRecord_OA(HT, rec, DH);
-    //Si ya estaba, sólo se aumenta en uno el valor de su multiplicidad y se marca como VÁLIDO en la tabla hash
-    if(aux!=NULL){
-        size_t prueba = (*HT)->h->array[aux->heap_index].mult;
-        (*HT)->h->array[aux->heap_index].mult++;
-        multiplicidad = (*HT)->h->array[aux->heap_index].mult;
-        aux->status = VALID;
-        
-    }
-    //Si no estaba, se procede a insertar
-    else{
-        //Se inserta en la tabla hash y se guarda su ubicación (en el heap) en el hash item correspondiente
-        aux = HTinsertRecord_OA(HT, rec, DH);
-        //Se guarda la ubicación del elemento en el heap (índice) en el respectivo hash_item
-        //OJO: Como apenas se va a insertar en el heap, se suma 1 al índice
-        aux->heap_index = (*HT)->h->index+1;
-        //Se inserta en el Heap
-        A = (unsigned char*)(*HT)->h->array[(*HT)->h->index].rec.bytes;
-        (*HT)->h->array[aux->heap_index].mult = 1;
-        insertHeap(rec, &(*HT)->h, HT);
-        A = (unsigned char*)(*HT)->h->array[(*HT)->h->index].rec.bytes;
-    }
-    printf("elemento insertado, contador = %ld\n", multiplicidad);
+    size_t contador = quashInsert(HT, rec);
+    out_buffer *out = &(*HT)->out;
+    if(contador == 1)
+        out->count.inserted++;
+    else
+        out->count.repeated++;
+    if((*HT)->cfg.output != OUT_VERBOSE)
+        return;
+    outText(out, "elemento insertado, contador = ");
+    outUInt(out, contador);
+    outWrite(out, "\n", 1);
+}
+
+/*Función para borrar un record (sin imprimir). Regresa la multiplicidad que le queda (0 si se eliminó) o -1 si no
+ * estaba*/
+long quashDelete(HTable_OA **HT, record *rec){
+    //En modo incremental, cada operación muda un tramo de la tabla anterior
+    migrateStep(*HT, MIGRATE_STEP, (*HT)->cfg.probing);
+    hash_item *aux = HTfindRecord_OA(HT, rec, (*HT)->cfg.probing);
+    if(aux==NULL)
+        return -1;
+    //Si la multiplicidad es mayor a 1, sólo se decrementa en 1
+    if((*HT)->h->array[aux->heap_index].mult>1)
+        return --(*HT)->h->array[aux->heap_index].mult;
+    //Si la ejecución llega hasta aquí, entonces la multiplicidad es 1
+    //Se borra en la tabla y se guarda la ubicación en el heap
+    size_t ubication = aux->heap_index;
+    HTdeleteRecordOA(HT, rec, (*HT)->cfg.probing);
+    //Se borra en el heap
+    deleteHeap(&(*HT)->h, ubication, HT);
+    shrinkHTable_OA(HT, (*HT)->cfg.probing);
+    return 0;
 }
 
 /*Función para borrar un elemento*/
 void DeleteElement(HTable_OA **HT, record *rec){
-    //Se verifica primero si el contador de multiplicidad tiene valor mayor a 1
-    hash_item *aux = HTfindRecord_OA(HT, rec, DH);
-    if(aux==NULL || aux->status==NOTVALID){
-        printf("elemento no presente en la tabla\n");
+    long contador = quashDelete(HT, rec);
+    out_buffer *out = &(*HT)->out;
+    int verbose = (*HT)->cfg.output == OUT_VERBOSE;
+    if(contador < 0){
+        out->count.absent++;
+        if(verbose)
+            outText(out, "elemento no presente en la tabla\n");
         return;
     }
-    size_t prueba = aux->heap_index;
-    if((*HT)->h->array[aux->heap_index].mult>1){
-        //Si es el caso que la multiplicidad es mayor a 0, sólo se decrementa en 1
-        (*HT)->h->array[aux->heap_index].mult--;
-        //Impresión en pantalla
-        char *str = (char*)(*HT)->h->array[aux->heap_index].rec.bytes;
-        printf("elemento ");
-        for(size_t j=0; j<(*HT)->h->array[aux->heap_index].rec.len; j++){
-                printf("%c", str[j]);
-            }
-        printf(" se decremento, nuevo contador = %ld\n", (*HT)->h->array[aux->heap_index].mult);
+    if(contador > 0){
+        out->count.decremented++;
+        if(verbose){
+            outText(out, "elemento ");
+            outRecord(out, (*HT)->h, rec);
+            outText(out, " se decremento, nuevo contador = ");
+            outUInt(out, contador);
+            outWrite(out, "\n", 1);
+        }
         return;
     }
-    //Si la ejecución llega hasta aquí, entonces la multiplicidad es 1
-    //Se borra en la tabla y se guarda la ubicación en el heap
-    aux = HTdeleteRecordOA(HT, rec, DH);
-    if(aux != NULL){
-        size_t ubication = aux->heap_index;
-        //Se borra en el heap
-        deleteHeap(&(*HT)->h, ubication, HT);
-        size_t contador = (*HT)->h->array[aux->heap_index].mult;
-        printf("elemento eliminado\n");
+    out->count.deleted++;
+    if(verbose)
+        outText(out, "elemento eliminado\n");
+}
+
+/*Mensaje de "update" con la multiplicidad que quedó en la llave nueva*/
+static void printUpdated(HTable_OA *HT, size_t contador){
+    HT->out.count.updated++;
+    if(HT->cfg.output != OUT_VERBOSE)
+        return;
+    outText(&HT->out, "elemento actualizado, contador = ");
+    outUInt(&HT->out, contador);
+    outWrite(&HT->out, "\n", 1);
+}
+
+/*Función para cambiar la llave "old_rec" por "new_rec" conservando su multiplicidad (comando "update old new")*/
+//NOTA: El nodo no sale del heap: se encuentra por su heap_index, se le escribe la llave nueva y se acomoda con un solo
+//... heapifyUp (si la llave bajó) o heapifyDown (si subió); con el motor radix sólo cambia de cubeta. Sólo la tabla
+//... hash cambia de casilla
+//OJO: Si la llave nueva ya estaba, las multiplicidades se suman y el nodo de la llave vieja se borra del heap
+void UpdateElement(HTable_OA **HT, record *old_rec, record *new_rec){
+    //En modo incremental, cada operación muda un tramo de la tabla anterior
+    migrateStep(*HT, MIGRATE_STEP, (*HT)->cfg.probing);
+    size_t mode = (*HT)->cfg.probing;
+    hash_item *aux = HTfindRecord_OA(HT, old_rec, mode);
+    if(aux==NULL){
+        (*HT)->out.count.update_absent++;
+        if((*HT)->cfg.output == OUT_VERBOSE)
+            outText(&(*HT)->out, "elemento no presente en la tabla\n");
+        return;
     }
-    else{
-        printf("elemento no presente en la tabla\n");
+    size_t ubication = aux->heap_index;
+    heap *H = (*HT)->h;
+    if(checkMatchRecord(old_rec, new_rec)==YES){
+        printUpdated(*HT, H->array[ubication].mult);
+        return;
+    }
+    int present = HTfindRecord_OA(HT, new_rec, mode) != NULL;
+    //Se compara antes de tocar la tabla (si ésta crece, la arena se compacta y los refs viejos dejan de servir)
+    int lower;
+    if((*HT)->cfg.numeric){
+        int64_t a, b;
+        memcpy(&a, new_rec->bytes, sizeof(int64_t));
+        memcpy(&b, old_rec->bytes, sizeof(int64_t));
+        lower = a < b;
+    }
+    else
+        lower = reccmp(*new_rec, *old_rec)==-1;
+    //Se guarda el nodo antes de mover nada (con RH, borrar en la tabla recorre casillas)
+    heap_item previous = H->array[ubication];
+    HTdeleteRecordOA(HT, old_rec, mode);
+    if(present){
+        //La llave nueva ya estaba: se le suma la multiplicidad (se vuelve a buscar porque HTdeleteRecordOA pudo mover
+        //... su casilla, pero no su nodo) y se borra el nodo de la llave vieja
+        hash_item *target = HTfindRecord_OA(HT, new_rec, mode);
+        H->array[target->heap_index].mult += previous.mult;
+        size_t mult = H->array[target->heap_index].mult;
+        deleteHeap(&(*HT)->h, ubication, HT);
+        shrinkHTable_OA(HT, mode);
+        printUpdated(*HT, mult);
         return;
     }
+    //La llave nueva va en una casilla libre de la tabla (ésta puede crecer, pero el nodo conserva su lugar en el heap)
+    aux = HTinsertRecord_OA(HT, new_rec, mode);
+    //NOTA: HTdeleteRecordOA le restó uno a la multiplicidad del nodo; se restaura con la copia
+    H = (*HT)->h;
+    H->array[ubication] = previous;
+    H->array[ubication].ref = aux->ref;
+    H->array[ubication].hash_index = tagIndex(*HT, aux - (*HT)->table);
+    aux->heap_index = ubication;
+    //Con el motor radix el nodo se cambia de cubeta
+    if(H->engine == ENGINE_RADIX){
+        radixUnlink(H, ubication);
+        radixInsert(*HT, H, ubication);
+    }
+    //Un solo reacomodo desde su lugar actual
+    else if(lower)
+        heapifyUp(&(*HT)->h, ubication, HT);
+    else
+        heapifyDown(&(*HT)->h, ubication, HT);
+    printUpdated(*HT, previous.mult);
 }
 
-/**************************MAIN******************************/
-int main(){
-    HTable_OA *quash = newHTable_OA();
-    size_t mode = DH;
-    record rec;
-    char buffer[100];
-    
-    while(fgets(buffer, 100, stdin) != NULL){
-        unsigned char *A = (unsigned char*)quash->h->array[quash->h->index].rec.bytes;
-        char command[20] = " ";
-        char number[30] = " ";
-        sscanf(buffer, "%s %s", command, number);
-        rec.bytes = number;
-        rec.len = strlen(number);
-        if(strcmp("insert", command)==0){               //insertar
-            InsertElement(&quash, &rec);
-            continue;
-        }
-        if(strcmp("delete", command)==0){               //borrar
-            sscanf(buffer, "%s %s", command, number);
-            memcpy(rec.bytes, number, strlen(number));
-            rec.len = strlen(number);
-            DeleteElement(&quash, &rec);
-            continue;
-        }
-       
-        if(strcmp("lookup", command)==0){                //Encontrar un elemento
-            sscanf(buffer, "%s %s", command, number);
-            memcpy(rec.bytes, number, strlen(number));
-            rec.len = strlen(number);
-            LookUpElement(&quash, &rec);
-            continue;
+/**************************CARGA MASIVA*********************************************/
+//NOTA: En vez de repetir InsertElement por cada llave, la carga masiva (1) calcula las llaves hash y elimina repetidos
+//... en paralelo, (2) reserva una sola vez la tabla y el heap del tamaño necesario y (3) arma el heap de abajo hacia
+//... arriba (Floyd) en O(n) en lugar de un heapifyUp por llave
+#define BULK_MIN_PER_THREAD 65536       //Llaves mínimas por hilo (con menos no conviene crear hilos)
+#define BULK_MAX_THREADS 16
+#define BULK_READ_CHUNK (1 << 20)     //Bloque inicial para leer el archivo de "load" (se duplica si no alcanza)
+
+/*Trabajo de un hilo de la carga masiva: calcula las llaves hash de [begin, end) y luego elimina los repetidos de su
+ * partición (las llaves con key % parts == part)*/
+typedef struct {
+    HTable_OA *HT;
+    record *recs;
+    hash_t *keys;
+    size_t n, begin, end;
+    size_t part, parts;
+    size_t *uniq;               //Índice (en recs) de la primera aparición de cada llave distinta de la partición
+    size_t *mult;               //Cuántas veces apareció cada una
+    size_t count;               //Cantidad de llaves distintas de la partición
+} bulk_job;
+
+/*Fase 1: llaves hash de un tramo de los records*/
+void* bulkHash(void *arg){
+    bulk_job *job = (bulk_job*)arg;
+    for(size_t i=job->begin; i<job->end; i++)
+        job->keys[i] = hashRecord(job->HT, &job->recs[i]);
+    return NULL;
+}
+
+/*Fase 2: elimina los repetidos de una partición con una tabla local de sondeo lineal (sólo índices)*/
+void* bulkDedupe(void *arg){
+    bulk_job *job = (bulk_job*)arg;
+    size_t m = 0;
+    for(size_t i=0; i<job->n; i++)
+        if(job->keys[i] % job->parts == job->part)
+            m++;
+    job->uniq = (size_t*)malloc(sizeof(size_t)*(m+1));
+    job->mult = (size_t*)malloc(sizeof(size_t)*(m+1));
+    size_t size = 16;
+    while(size < 2*m)
+        size <<= 1;
+    //Cada casilla guarda la posición (+1) en "uniq" de una llave ya vista (0 = libre)
+    size_t *slots = (size_t*)calloc(size, sizeof(size_t));
+    if(job->uniq == NULL || job->mult == NULL || slots == NULL){
+        fprintf(stderr, "Error en malloc!\n");
+        exit(1);
+    }
+    job->count = 0;
+    for(size_t i=0; i<job->n; i++){
+        hash_t key = job->keys[i];
+        if(key % job->parts != job->part)
+            continue;
+        size_t s = (key / job->parts) & (size - 1);
+        while(1){
+            if(slots[s] == 0){
+                job->uniq[job->count] = i;
+                job->mult[job->count] = 1;
+                slots[s] = ++job->count;
+                break;
+            }
+            size_t u = job->uniq[slots[s]-1];
+            if(job->keys[u] == key && checkMatchRecord(&job->recs[u], &job->recs[i])==YES){
+                job->mult[slots[s]-1]++;
+                break;
+            }
+            s = (s + 1) & (size - 1);
+        }
+    }
+    free(slots);
+    return NULL;
+}
+
+/*Función para cargar de una vez "n" records al quash. Regresa la cantidad de llaves distintas que se agregaron*/
+//NOTA: Los repetidos (entre sí o con lo que ya había en el quash) sólo suman a su multiplicidad
+size_t bulkLoad(HTable_OA **HT, record *recs, size_t n){
+    size_t mode = (*HT)->cfg.probing;
+    if(n == 0)
+        return 0;
+    //Hilos: uno por núcleo, pero cada uno con al menos BULK_MIN_PER_THREAD llaves
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t threads = n / BULK_MIN_PER_THREAD;
+    if(threads > (size_t)cores)
+        threads = cores;
+    if(threads > BULK_MAX_THREADS)
+        threads = BULK_MAX_THREADS;
+    if(threads < 1)
+        threads = 1;
+    hash_t *keys = (hash_t*)malloc(sizeof(hash_t)*n);
+    bulk_job jobs[BULK_MAX_THREADS];
+    pthread_t tid[BULK_MAX_THREADS];
+    if(keys == NULL){
+        fprintf(stderr, "Error en malloc!\n");
+        exit(1);
+    }
+    for(size_t t=0; t<threads; t++){
+        jobs[t].HT = *HT;
+        jobs[t].recs = recs;
+        jobs[t].keys = keys;
+        jobs[t].n = n;
+        jobs[t].begin = n*t/threads;
+        jobs[t].end = n*(t+1)/threads;
+        jobs[t].part = t;
+        jobs[t].parts = threads;
+    }
+    //Fase 1 y fase 2 (con un solo hilo se llaman directamente)
+    if(threads == 1){
+        bulkHash(&jobs[0]);
+        bulkDedupe(&jobs[0]);
+    }
+    else{
+        for(size_t t=0; t<threads; t++)
+            pthread_create(&tid[t], NULL, bulkHash, &jobs[t]);
+        for(size_t t=0; t<threads; t++)
+            pthread_join(tid[t], NULL);
+        for(size_t t=0; t<threads; t++)
+            pthread_create(&tid[t], NULL, bulkDedupe, &jobs[t]);
+        for(size_t t=0; t<threads; t++)
+            pthread_join(tid[t], NULL);
+    }
+    size_t distinct = 0;
+    for(size_t t=0; t<threads; t++)
+        distinct += jobs[t].count;
+
+    //Fase 3: se reserva la tabla una sola vez (el menor tamaño de HASH_SIZE donde caben todos sin pasar la carga
+    //... máxima del sondeo) y el heap con lugar para todos los nodos nuevos
+    //NOTA: Una migración pendiente se termina antes, y con SW se remodela también si hay tumbas (cuentan como carga)
+    while((*HT)->old_table != NULL)
+        migrateStep(*HT, MIGRATE_STEP, mode);
+    size_t needed = (*HT)->occupied_elements + distinct;
+    size_t index = (*HT)->index_size;
+    while(index + 1 < tableCount(&(*HT)->cfg) && loadLimit(&(*HT)->cfg, tableSize(&(*HT)->cfg, index)) < needed)
+        index++;
+    if(index != (*HT)->index_size || (mode == SW && (*HT)->tombstones > 0)){
+        (*HT) = RemodelHTableTo_OA(*HT, index, mode);
+        while((*HT)->old_table != NULL)
+            migrateStep(*HT, MIGRATE_STEP, mode);
+    }
+    heap *h = (*HT)->h;
+    while(h->index + distinct + 1 >= h->cap)
+        growHeap(*HT, h);
+
+    //Fase 4: se colocan las llaves nuevas en la tabla y sus nodos al final del heap (todavía sin orden)
+    int existing = (*HT)->occupied_elements > 0;
+    size_t added = 0, first = h->index + 1;
+    for(size_t t=0; t<threads; t++){
+        for(size_t j=0; j<jobs[t].count; j++){
+            record *rec = &recs[jobs[t].uniq[j]];
+            hash_t key = keys[jobs[t].uniq[j]];
+            //Si la llave ya estaba en el quash, sólo aumenta su multiplicidad
+            hash_item *item = existing ? HTfindkey_OA(HT, key, mode, rec) : NULL;
+            if(item != NULL){
+                h->array[item->heap_index].mult += jobs[t].mult[j];
+                continue;
+            }
+            size_t slot = findFreeSlot(HT, key, mode);
+            if((*HT)->cfg.numeric)
+                memcpy(&(*HT)->table[slot].num, rec->bytes, sizeof(int64_t));
+            else if(arenaIntern(&(*HT)->keys, rec, &(*HT)->table[slot].ref) == NO){
+                fprintf(stderr, "Cannot allocate memory for element!\n");
+                exit(1);
+            }
+            (*HT)->meta[slot].key = key;
+            (*HT)->meta[slot].status = VALID;
+            (*HT)->occupied_elements++;
+            size_t pos = ++h->index;
+            h->array[pos].ref = (*HT)->table[slot].ref;
+            h->array[pos].mult = jobs[t].mult[j];
+            h->array[pos].hash_index = tagIndex(*HT, slot);
+            (*HT)->table[slot].heap_index = pos;
+            added++;
         }
-        if(strcmp("deleteMin", command)==0){                //Borrar el elemento menor 
-            deleteMin(&quash);
+        free(jobs[t].uniq);
+        free(jobs[t].mult);
+    }
+    free(keys);
+
+    //Fase 5 con el motor radix: cada nodo nuevo va a su cubeta. Si alguno es menor a "last", se reparten todos una
+    //... sola vez con la menor llave nueva (y no una vez por cada llave menor)
+    if(h->engine == ENGINE_RADIX){
+        uint64_t min = h->last;
+        for(size_t i=first; i<=h->index; i++)
+            if(radixKey(&h->array[i]) < min)
+                min = radixKey(&h->array[i]);
+        if(min < h->last){
+            (*HT)->stats.radix_rebuilds++;
+            radixRebuild(h, min);
+        }
+        else
+            for(size_t i=first; i<=h->index; i++)
+                radixPush(h, i, radixBucketOf(radixKey(&h->array[i]), h->last));
+        return added;
+    }
+    //Fase 5: Floyd. Se hace heapifyDown desde el último nodo con hijos hasta la raíz
+    if(h->index > 1){
+        for(size_t i=parent(h->index); i>=1; i--)
+            heapifyDown(&h, i, HT);
+    }
+    return added;
+}
+
+/*Función para cargar las llaves de un archivo (separadas por espacios o saltos de línea)*/
+void LoadElements(HTable_OA **HT, const char *path){
+    FILE *file = fopen(path, "rb");
+    if(file == NULL){
+        outFlush(&(*HT)->out);
+        fprintf(stderr, "No se pudo abrir el archivo %s\n", path);
+        //Un "load" de un journal escrito antes de guardar las llaves: sin el archivo no se puede reconstruir
+        if((*HT)->wal.replay)
+            exit(1);
+        return;
+    }
+    //Se lee el archivo completo; los records apuntan directamente a sus bytes
+    //NOTA: Se lee en bloques que crecen (y no con el largo de ftell) para aceptar también tuberías y FIFOs
+    size_t got = 0, length = BULK_READ_CHUNK;
+    char *text = (char*)malloc(length + 1);
+    while(text != NULL){
+        got += fread(text + got, 1, length - got, file);
+        if(got < length)
+            break;
+        length *= 2;
+        text = (char*)realloc(text, length + 1);
+    }
+    if(text == NULL){
+        fprintf(stderr, "Error en malloc!\n");
+        exit(1);
+    }
+    if(ferror(file)){
+        fclose(file);
+        free(text);
+        outFlush(&(*HT)->out);
+        fprintf(stderr, "No se pudo leer el archivo %s\n", path);
+        if((*HT)->wal.replay)
+            exit(1);
+        return;
+    }
+    fclose(file);
+    text[got] = '\0';
+    //Cada palabra es una llave (a lo más una por cada dos bytes)
+    size_t cap = got/2 + 1;
+    record *recs = (record*)malloc(sizeof(record)*cap);
+    int64_t *nums = (*HT)->cfg.numeric ? (int64_t*)malloc(sizeof(int64_t)*cap) : NULL;
+    if(recs == NULL || ((*HT)->cfg.numeric && nums == NULL)){
+        fprintf(stderr, "Error en malloc!\n");
+        exit(1);
+    }
+    size_t n = 0, invalid = 0;
+    char *p = text;
+    while(*p){
+        while(*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')
+            p++;
+        if(*p == '\0')
+            break;
+        char *start = p;
+        while(*p && *p != ' ' && *p != '\n' && *p != '\r' && *p != '\t')
+            p++;
+        if((*HT)->cfg.numeric){
+            //Sólo se aceptan palabras que sean un entero completo dentro del rango de int64_t (las demás se omiten)
+            char *end;
+            errno = 0;
+            nums[n] = strtoll(start, &end, 10);
+            if(end != p || errno == ERANGE){
+                invalid++;
+                continue;
+            }
+            recs[n].bytes = &nums[n];
+            recs[n].len = sizeof(int64_t);
+        }
+        else{
+            recs[n].bytes = start;
+            recs[n].len = p - start;
+        }
+        n++;
+    }
+    //Al journal van las llaves (no la ruta): reproducirlo no depende de que el archivo siga igual
+    for(size_t i=0; i<n; i++)
+        journalAppend(&(*HT)->wal, OP_INSERT, &recs[i], NULL);
+    size_t added = bulkLoad(HT, recs, n);
+    if(invalid > 0){
+        outFlush(&(*HT)->out);
+        fprintf(stderr, "%zu llaves no validas omitidas en %s\n", invalid, path);
+    }
+    if((*HT)->cfg.output == OUT_VERBOSE){
+        out_buffer *out = &(*HT)->out;
+        outText(out, "elementos cargados = ");
+        outUInt(out, n);
+        outText(out, ", nuevos = ");
+        outUInt(out, added);
+        outWrite(out, "\n", 1);
+    }
+    free(nums);
+    free(recs);
+    free(text);
+}
+
+/**************************SNAPSHOTS*********************************************/
+//NOTA: Un snapshot es una copia directa de los arreglos del quash (casillas y datos de sondeo de la tabla, bytes de
+//... control, nodos del heap con su "mult" y su "hash_index", y la arena de llaves) en un solo archivo. Como las
+//... llaves se guardan como refs (desplazamientos) y los nodos y casillas se apuntan por índice, el archivo no depende
+//... de las direcciones en memoria: al restaurar se mapea con mmap y los arreglos se usan ahí mismo, sin volver a
+//... calcular hashes ni armar el heap. Sólo se leen del disco las páginas que se van tocando
+//NOTA 2: El mapeo es privado (copy-on-write): las operaciones posteriores no modifican el archivo. Si un arreglo tiene
+//... que crecer o la tabla se remodela, se copia a memoria propia y se suelta su parte del mapeo
+#define SNAPSHOT_MAGIC "QUASHSNP"
+#define SNAPSHOT_VERSION 2
+#define SNAPSHOT_ALIGN 4096     //Cada sección empieza en una página (se puede soltar con munmap por separado)
+
+/*Encabezado del archivo (ocupa la primera página)*/
+typedef struct {
+    char magic[8];              //SNAPSHOT_MAGIC
+    uint32_t version;
+    uint32_t heap_arity;        //HEAP_ARITY con la que se acomodó el heap
+    uint32_t item_size;         //sizeof(hash_item), sizeof(hash_meta) y sizeof(heap_item) del programa que lo escribió
+    uint32_t meta_size;
+    uint32_t node_size;
+    int32_t hash_type;          //Opciones de la tabla (familia hash, modo numérico y sondeo)
+    int32_t numeric;
+    int32_t probing;
+    int32_t pow2;               //YES si el tamaño es potencia de dos
+    int32_t engine;             //Motor de prioridad (las cubetas del radix no se guardan: se reparten al restaurar)
+    uint64_t index_size;        //Tamaño de la tabla (índice de capacidad, ver tableSize)
+    uint64_t occupied;
+    uint64_t tombstones;
+    uint64_t tag;               //Marca de la tabla (va también en el "hash_index" de cada nodo)
+    uint64_t hist;
+    uint64_t heap_index;        //Último nodo válido del heap
+    uint64_t keys_used;
+    uint64_t keys_dead;
+    uint64_t table_at;          //Desplazamiento de cada sección en el archivo
+    uint64_t meta_at;
+    uint64_t ctrl_at;           //0 si el sondeo no es SW
+    uint64_t heap_at;
+    uint64_t keys_at;
+    uint64_t length;            //Largo total del archivo
+} snapshot_header;
+
+static inline size_t alignSnapshot(size_t offset){
+    return (offset + SNAPSHOT_ALIGN - 1) / SNAPSHOT_ALIGN * SNAPSHOT_ALIGN;
+}
+
+/*Escribe una sección en su desplazamiento (los huecos entre secciones quedan en ceros)*/
+static int writeSection(int fd, const void *bytes, size_t len, size_t at){
+    const char *p = (const char*)bytes;
+    while(len > 0){
+        ssize_t put = pwrite(fd, p, len, at);
+        if(put < 0 && errno == EINTR)
             continue;
+        if(put <= 0)
+            return NO;
+        p += put;
+        at += put;
+        len -= put;
+    }
+    return YES;
+}
+
+/*Función para guardar el quash en "path". Regresa NO si no se pudo escribir*/
+//NOTA: Se escribe primero en "path.tmp" y luego se renombra: si el archivo anterior está mapeado (se restauró de él),
+//... sus páginas no cambian, y si el programa se cae a la mitad, el snapshot anterior sigue completo
+int saveSnapshot(HTable_OA *HT, const char *path){
+    if(path[0] == '\0')
+        return NO;
+    //Si había una migración en curso, primero se termina (el snapshot guarda una sola tabla)
+    while(HT->old_table != NULL)
+        migrateStep(HT, HT->old_size, HT->cfg.probing);
+    heap *H = HT->h;
+    snapshot_header head;
+    memset(&head, 0, sizeof(head));
+    memcpy(head.magic, SNAPSHOT_MAGIC, sizeof(head.magic));
+    head.version = SNAPSHOT_VERSION;
+    head.heap_arity = HEAP_ARITY;
+    head.item_size = sizeof(hash_item);
+    head.meta_size = sizeof(hash_meta);
+    head.node_size = sizeof(heap_item);
+    head.hash_type = HT->cfg.hash_type;
+    head.numeric = HT->cfg.numeric;
+    head.probing = HT->cfg.probing;
+    head.pow2 = HT->cfg.pow2;
+    head.engine = H->engine;
+    head.index_size = HT->index_size;
+    head.occupied = HT->occupied_elements;
+    head.tombstones = HT->tombstones;
+    head.tag = HT->tag;
+    head.hist = HT->hist;
+    head.heap_index = H->index;
+    head.keys_used = HT->keys.used;
+    head.keys_dead = HT->keys.dead;
+    //Secciones: tabla, datos de sondeo, control (SW), heap (con la casilla libre que sigue al último nodo) y arena
+    size_t table_len = sizeof(hash_item)*HT->size;
+    size_t meta_len = sizeof(hash_meta)*HT->size;
+    size_t ctrl_len = (HT->ctrl != NULL) ? HT->size + GROUP : 0;
+    size_t heap_len = sizeof(heap_item)*(H->index + 2);
+    head.table_at = SNAPSHOT_ALIGN;
+    head.meta_at = alignSnapshot(head.table_at + table_len);
+    head.ctrl_at = ctrl_len ? alignSnapshot(head.meta_at + meta_len) : 0;
+    head.heap_at = alignSnapshot((ctrl_len ? head.ctrl_at + ctrl_len : head.meta_at + meta_len));
+    head.keys_at = alignSnapshot(head.heap_at + heap_len);
+    head.length = head.keys_at + HT->keys.used;
+
+    char tmp[4096 + 8];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0)
+        return NO;
+    //El nodo que sigue al último puede no estar inicializado: se escribe en ceros
+    heap_item spare;
+    memset(&spare, 0, sizeof(spare));
+    int ok = ftruncate(fd, head.length) == 0 &&
+             writeSection(fd, &head, sizeof(head), 0) &&
+             writeSection(fd, HT->table, table_len, head.table_at) &&
+             writeSection(fd, HT->meta, meta_len, head.meta_at) &&
+             (ctrl_len == 0 || writeSection(fd, HT->ctrl, ctrl_len, head.ctrl_at)) &&
+             writeSection(fd, H->array, heap_len - sizeof(heap_item), head.heap_at) &&
+             writeSection(fd, &spare, sizeof(spare), head.heap_at + heap_len - sizeof(heap_item)) &&
+             writeSection(fd, HT->keys.bytes, HT->keys.used, head.keys_at) &&
+             fsync(fd) == 0;
+    ok = (close(fd) == 0) && ok;
+    if(!ok || rename(tmp, path) != 0){
+        unlink(tmp);
+        return NO;
+    }
+    return YES;
+}
+
+/*Suma (wyhash64) de todos los bytes del archivo "path". Regresa NO si no se puede leer*/
+int fileChecksum(const char *path, uint64_t *sum){
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if(fd < 0)
+        return NO;
+    if(fstat(fd, &st) != 0){
+        close(fd);
+        return NO;
+    }
+    if(st.st_size == 0){
+        close(fd);
+        *sum = wyhash64(NULL, 0);
+        return YES;
+    }
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED)
+        return NO;
+    madvise(data, st.st_size, MADV_SEQUENTIAL);
+    *sum = wyhash64((const unsigned char*)data, st.st_size);
+    munmap(data, st.st_size);
+    return YES;
+}
+
+/*Función para cambiar el contenido del quash por el del snapshot "path" (se mapea y se usa ahí mismo)*/
+//NOTA: La familia hash, el sondeo, el tipo de tamaños y el motor se toman del archivo (describen cómo están acomodadas las casillas); el modo
+//... numérico debe coincidir porque cambia la forma de leer las llaves. Regresa NO (sin tocar el quash) si el archivo
+//... no se puede usar
+int restoreSnapshot(HTable_OA *HT, const char *path){
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+        return NO;
+    snapshot_header head;
+    struct stat st;
+    if(fstat(fd, &st) != 0 || pread(fd, &head, sizeof(head), 0) != (ssize_t)sizeof(head)){
+        close(fd);
+        return NO;
+    }
+    //Opciones de la tabla: sólo valores que este programa conoce (antes de usarlas para calcular el tamaño)
+    if((head.hash_type != H_ADLER && head.hash_type != H_WY) || head.probing < LP || head.probing > SW ||
+       (head.pow2 != NO && head.pow2 != YES)){
+        close(fd);
+        return NO;
+    }
+    HTconfig layout = HT->cfg;
+    layout.pow2 = head.pow2;
+    size_t size = head.index_size < tableCount(&layout) ? tableSize(&layout, head.index_size) : 0;
+    //Cada sección debe terminar antes de que empiece la siguiente (y la última, dentro del archivo). Los conteos se
+    //... acotan primero para que ninguna suma se desborde
+    if(head.length != (uint64_t)st.st_size || head.table_at > head.length || head.meta_at > head.length ||
+       head.ctrl_at > head.length || head.heap_at > head.length || head.keys_at > head.length ||
+       head.heap_index > head.length/sizeof(heap_item) ||
+       head.keys_used > head.length || head.occupied > size || head.heap_index != head.occupied ||
+       head.tombstones > size || head.keys_dead > head.keys_used ||
+       (head.ctrl_at != 0 && (head.ctrl_at < head.meta_at + sizeof(hash_meta)*size ||
+                              head.heap_at < head.ctrl_at + size + GROUP))){
+        close(fd);
+        return NO;
+    }
+    if(memcmp(head.magic, SNAPSHOT_MAGIC, sizeof(head.magic)) != 0 || head.version != SNAPSHOT_VERSION ||
+       head.heap_arity != HEAP_ARITY || head.item_size != sizeof(hash_item) || head.meta_size != sizeof(hash_meta) ||
+       head.node_size != sizeof(heap_item) || head.numeric != HT->cfg.numeric || head.index_size >= tableCount(&layout) ||
+       (head.engine != ENGINE_HEAP && (head.engine != ENGINE_RADIX || !head.numeric)) ||
+       (head.probing == SW) != (head.ctrl_at != 0) || head.length != (uint64_t)st.st_size ||
+       head.table_at != SNAPSHOT_ALIGN || head.meta_at < head.table_at + sizeof(hash_item)*size ||
+       head.heap_at < head.meta_at + sizeof(hash_meta)*size ||
+       head.keys_at < head.heap_at + sizeof(heap_item)*(head.heap_index + 2) ||
+       head.keys_at + head.keys_used > head.length || SNAPSHOT_ALIGN % sysconf(_SC_PAGESIZE) != 0){
+        close(fd);
+        return NO;
+    }
+    unsigned char *base = (unsigned char*)mmap(NULL, head.length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(base == MAP_FAILED)
+        return NO;
+    //La página del encabezado ya no se necesita
+    munmap(base, SNAPSHOT_ALIGN);
+
+    //Se sueltan los arreglos actuales y se colocan los del archivo
+    while(HT->old_table != NULL)
+        migrateStep(HT, HT->old_size, HT->cfg.probing);
+    releaseTables(HT->table, HT->meta, HT->ctrl, HT->size, HT->mapped, HT->cfg.huge);
+    freeArena(&HT->keys);
+    heap *H = HT->h;
+    releaseBlock(H->array, sizeof(heap_item)*H->cap, H->mapped, H->huge);
+
+    HT->cfg.hash_type = head.hash_type;
+    HT->cfg.probing = head.probing;
+    HT->cfg.pow2 = head.pow2;
+    HT->cfg.engine = head.engine;
+    HT->index_size = head.index_size;
+    HT->size = size;
+    HT->table = (hash_item*)(base + head.table_at);
+    HT->meta = (hash_meta*)(base + head.meta_at);
+    HT->ctrl = head.ctrl_at ? base + head.ctrl_at : NULL;
+    HT->mapped = YES;
+    HT->occupied_elements = head.occupied;
+    HT->tombstones = head.tombstones;
+    HT->tag = head.tag;
+    HT->hist = head.hist;
+    HT->migrate_pos = 0;
+    HT->keys.bytes = base + head.keys_at;
+    HT->keys.used = head.keys_used;
+    HT->keys.cap = head.keys_used;
+    HT->keys.dead = head.keys_dead;
+    HT->keys.mapped = YES;
+    H->array = (heap_item*)(base + head.heap_at);
+    H->index = head.heap_index;
+    H->cap = head.heap_index + 2;
+    H->mapped = YES;
+    //Con el motor radix se reparten los nodos en cubetas a partir de la menor llave
+    freeRadix(H);
+    H->engine = head.engine;
+    if(H->engine == ENGINE_RADIX){
+        H->link = (uint64_t*)malloc(sizeof(uint64_t)*H->cap);
+        if(H->link == NULL){
+            fprintf(stderr, "Error en malloc!\n");
+            exit(1);
+        }
+        uint64_t min = H->index ? radixKey(&H->array[1]) : 0;
+        for(size_t i=2; i<=H->index; i++)
+            if(radixKey(&H->array[i]) < min)
+                min = radixKey(&H->array[i]);
+        radixRebuild(H, min);
+    }
+    //Las búsquedas en la tabla saltan de una casilla a otra: no conviene leer páginas por adelantado
+    madvise(base + head.table_at, head.heap_at - head.table_at, MADV_RANDOM);
+    return YES;
+}
+
+/*Comandos "snapshot <archivo>" y "restore <archivo>"*/
+void SnapshotElements(HTable_OA **HT, const char *path){
+    if(saveSnapshot(*HT, path) == NO){
+        outFlush(&(*HT)->out);
+        fprintf(stderr, "No se pudo escribir el snapshot %s\n", path);
+        return;
+    }
+    //El snapshot ya contiene todo lo que había en el journal: éste vuelve a empezar desde el snapshot
+    if((*HT)->wal.fd >= 0){
+        uint64_t sum;
+        char *base = realpath(path, NULL);
+        if(base == NULL || fileChecksum(base, &sum) == NO){
+            fprintf(stderr, "No se pudo leer el snapshot %s\n", path);
+            exit(1);
         }
-         if(strcmp("print", command)==0){                //imprimir
-            print_Heap(quash);
+        journalReset(&(*HT)->wal, base, sum);
+        free(base);
+    }
+    if((*HT)->cfg.output == OUT_VERBOSE){
+        outText(&(*HT)->out, "snapshot guardado, elementos = ");
+        outUInt(&(*HT)->out, (*HT)->occupied_elements);
+        outWrite(&(*HT)->out, "\n", 1);
+    }
+}
+
+void RestoreElements(HTable_OA **HT, const char *path){
+    if(restoreSnapshot(*HT, path) == NO){
+        outFlush(&(*HT)->out);
+        fprintf(stderr, "No se pudo restaurar el snapshot %s\n", path);
+        if((*HT)->wal.replay)
+            exit(1);
+        return;
+    }
+    if((*HT)->cfg.output == OUT_VERBOSE){
+        outText(&(*HT)->out, "snapshot restaurado, elementos = ");
+        outUInt(&(*HT)->out, (*HT)->occupied_elements);
+        outWrite(&(*HT)->out, "\n", 1);
+    }
+}
+
+/**************************ESTADÍSTICAS*********************************************/
+//NOTA: Los contadores de HTable_OA.stats se llevan siempre; lo que depende del estado de la tabla (casillas marcadas,
+//... bytes de cada arreglo) se calcula aquí, recorriendo los datos de sondeo sólo cuando se piden las estadísticas
+
+/*Estado del quash en un momento dado*/
+typedef struct {
+    size_t size;                //Casillas de la tabla actual
+    size_t occupied;            //Elementos (llaves distintas)
+    double load;                //occupied/size
+    size_t lazy_deleted;        //Casillas marcadas como borradas (DH, LP y QP)
+    size_t leapt;               //Casillas marcadas como saltadas
+    size_t tombstones;          //Tumbas en los bytes de control (SW)
+    size_t heap_nodes, heap_cap;
+    int engine;                 //Motor de prioridad (ENGINE_HEAP o ENGINE_RADIX)
+    int64_t radix_last;         //Último mínimo extraído por el motor radix
+    int hist;                   //Histéresis actual para reducir la tabla
+    int migrating;              //YES si hay una migración incremental en curso
+    size_t key_bytes;           //Bytes de llaves vivas en la arena (0 en modo numérico)
+    size_t dead_key_bytes;      //Bytes de llaves borradas que siguen en la arena
+    size_t arena_bytes;         //Capacidad reservada de la arena
+    size_t meta_bytes;          //Bytes de tabla, datos de sondeo, control y heap (incluye la tabla anterior)
+    quash_stats counters;
+} quash_report;
+
+/*Función para obtener las estadísticas del quash*/
+quash_report quashReport(HTable_OA *HT){
+    quash_report r;
+    memset(&r, 0, sizeof(r));
+    r.size = HT->size;
+    r.occupied = HT->occupied_elements;
+    r.load = (double)HT->occupied_elements/HT->size;
+    for(size_t i=0; i<HT->size; i++){
+        r.lazy_deleted += HT->meta[i].lazy_deleted == YES;
+        r.leapt += HT->meta[i].leapt == YES;
+    }
+    r.tombstones = HT->tombstones;
+    r.heap_nodes = HT->h->index;
+    r.heap_cap = HT->h->cap;
+    r.engine = HT->h->engine;
+    r.radix_last = (int64_t)(HT->h->last ^ ((uint64_t)1 << 63));
+    r.hist = HT->hist;
+    r.migrating = HT->old_table != NULL;
+    //Se suman los largos de las llaves del heap (uno por llave viva, también durante una migración): en la arena
+    //... pueden quedar bytes que ninguna llave usa, como los infinitos de un snapshot escrito por una versión anterior
+    if(!HT->cfg.numeric)
+        for(size_t i=1; i<=HT->h->index; i++)
+            r.key_bytes += refLen(HT->h->array[i].ref);
+    r.dead_key_bytes = HT->keys.dead;
+    r.arena_bytes = HT->keys.cap;
+    r.meta_bytes = (sizeof(hash_item) + sizeof(hash_meta))*(HT->size + (r.migrating ? HT->old_size : 0)) +
+                   sizeof(heap_item)*HT->h->cap;
+    if(HT->ctrl != NULL)
+        r.meta_bytes += HT->size + GROUP;
+    if(HT->old_ctrl != NULL)
+        r.meta_bytes += HT->old_size + GROUP;
+    if(HT->h->engine == ENGINE_RADIX){
+        r.meta_bytes += sizeof(uint64_t)*HT->h->cap;
+        for(size_t b=0; b<RADIX_BUCKETS; b++)
+            r.meta_bytes += sizeof(size_t)*HT->h->bucket[b].cap;
+    }
+    r.counters = HT->stats;
+    return r;
+}
+
+/*Escribe un histograma de colisiones ("15+" junta los de 15 o más)*/
+static void outProbes(out_buffer *out, const char *title, const size_t *histogram){
+    outText(out, title);
+    for(size_t i=0; i<PROBE_BUCKETS; i++){
+        if(histogram[i] == 0)
             continue;
+        outWrite(out, " ", 1);
+        outUInt(out, i);
+        if(i == PROBE_BUCKETS - 1)
+            outWrite(out, "+", 1);
+        outWrite(out, ":", 1);
+        outUInt(out, histogram[i]);
+    }
+    outWrite(out, "\n", 1);
+}
+
+/*Comando "stats"*/
+//NOTA: Se imprime en todos los modos de salida: es una consulta explícita, no el resultado de una operación
+void StatsElements(HTable_OA **HT){
+    quash_report r = quashReport(*HT);
+    out_buffer *out = &(*HT)->out;
+    char line[512];
+    snprintf(line, sizeof(line), "tabla: casillas = %zu, ocupadas = %zu, carga = %.3f, lazy_deleted = %zu, leapt = %zu, "
+             "tumbas = %zu, hist = %d%s\n", r.size, r.occupied, r.load, r.lazy_deleted, r.leapt, r.tombstones, r.hist,
+             r.migrating ? ", migrando" : "");
+    outText(out, line);
+    if(r.engine == ENGINE_RADIX)
+        snprintf(line, sizeof(line), "heap: motor radix, nodos = %zu, capacidad = %zu, last = %" PRId64 ", "
+                 "redistribuidos = %zu, reconstrucciones = %zu\n", r.heap_nodes, r.heap_cap, r.radix_last,
+                 r.counters.radix_moves, r.counters.radix_rebuilds);
+    else
+        snprintf(line, sizeof(line), "heap: nodos = %zu, capacidad = %zu, swaps up = %zu, swaps down = %zu\n",
+                 r.heap_nodes, r.heap_cap, r.counters.swaps_up, r.counters.swaps_down);
+    outText(out, line);
+    outProbes(out, "colisiones DHFindKey:", r.counters.find_probes);
+    outProbes(out, "colisiones DoubleHashing:", r.counters.insert_probes);
+    snprintf(line, sizeof(line), "remodelados: tabla = %zu (%.3f ms), heap = %zu (%.3f ms)\n", r.counters.remodels,
+             r.counters.remodel_ns*1e-6, r.counters.heap_grows, r.counters.heap_grow_ns*1e-6);
+    outText(out, line);
+    snprintf(line, sizeof(line), "bytes: llaves = %zu, llaves borradas = %zu, arena = %zu (compactaciones = %zu), "
+             "metadatos = %zu\n", r.key_bytes, r.dead_key_bytes, r.arena_bytes, r.counters.compactions, r.meta_bytes);
+    outText(out, line);
+}
+
+/**************************QUASH POR SHARDS (CONCURRENTE)*********************************************/
+//NOTA: Las llaves se reparten por su llave hash entre N quash independientes (shards), cada uno con su tabla, su heap,
+//... su arena y su candado. Así, inserts, búsquedas y borrados de hilos distintos sólo compiten si caen en el mismo
+//... shard. El deleteMin global usa un árbol de torneo sobre una copia del mínimo de cada shard
+//OJO: Estas funciones no imprimen nada (regresan los contadores) para que las puedan usar varios hilos a la vez
+
+/*Copia de una llave fuera de la arena (el mínimo de un shard o la llave que sacó un deleteMin)*/
+typedef struct {
+    int present;                //NO si el shard está vacío (cuenta como infinito en el torneo)
+    int64_t num;                //Llave en modo numérico
+    unsigned char *bytes;       //Bytes de la llave en modo de cadenas (memoria propia)
+    size_t len, cap;
+    size_t version;             //Versión del shard cuando se tomó la copia
+} shard_key;
+
+/*Un shard: un quash completo con su candado*/
+typedef struct {
+    HTable_OA *HT;
+    pthread_mutex_t lock;
+    size_t version;             //Aumenta (con "lock") cada vez que cambia el mínimo del shard
+    shard_key min;              //Mínimo publicado para el torneo (protegido por el tree_lock del quash)
+} quash_shard;
+
+/*Quash por shards*/
+typedef struct {
+    quash_shard *shards;
+    size_t count;               //Cantidad de shards
+    size_t leaves;              //Hojas del árbol de torneo (potencia de dos >= count)
+    size_t *tree;               //Árbol de torneo: tree[i] es el shard ganador del subárbol i (hojas en [leaves, 2*leaves))
+    pthread_mutex_t tree_lock;
+    HTconfig cfg;               //Opciones de todos los shards
+} sharded_quash;
+
+/*Copia en "key" la llave de un nodo del heap*/
+static void copyKey(shard_key *key, heap *h, heap_item *item){
+    key->present = YES;
+    if(h->numeric){
+        key->num = item->num;
+        return;
+    }
+    record rec = arenaView(h->keys, item->ref);
+    if(rec.len > key->cap){
+        key->cap = rec.len;
+        key->bytes = (unsigned char*)realloc(key->bytes, key->cap);
+        if(key->bytes == NULL){
+            fprintf(stderr, "Error en malloc!\n");
+            exit(1);
         }
-        if(strcmp("stop", command)==0){                 //Parar (crea un ciclo infinito para medir memoria en servidor)
-            size_t i = 0;
-            while(i<1){
-                continue;
+    }
+    memcpy(key->bytes, rec.bytes, rec.len);
+    key->len = rec.len;
+}
+
+/*Compara dos copias de llaves (una ausente es mayor que cualquiera)*/
+static int keycmp(int numeric, shard_key *A, shard_key *B){
+    if(!A->present || !B->present)
+        return B->present - A->present;
+    if(numeric)
+        return (A->num > B->num) - (A->num < B->num);
+    record a = {A->bytes, A->len}, b = {B->bytes, B->len};
+    return reccmp(a, b);
+}
+
+/*Shard al que pertenece una llave hash (se mezcla primero para no depender de cómo reparte la tabla)*/
+static inline size_t shardOf(sharded_quash *Q, hash_t key){
+    return ((uint64_t)(uint32_t)(key * 0x85EBCA6Bu) * Q->count) >> 32;
+}
+
+/*Función para crear un quash con "count" shards*/
+sharded_quash* newShardedQuash(size_t count, HTconfig cfg){
+    sharded_quash *Q = (sharded_quash*)malloc(sizeof(sharded_quash));
+    if(Q == NULL || count == 0){
+        fprintf(stderr, "Cannot allocate memory for table.");
+        exit(1);
+    }
+    Q->count = count;
+    Q->cfg = cfg;
+    Q->leaves = 1;
+    while(Q->leaves < count)
+        Q->leaves <<= 1;
+    Q->shards = (quash_shard*)calloc(count, sizeof(quash_shard));
+    Q->tree = (size_t*)malloc(sizeof(size_t)*2*Q->leaves);
+    if(Q->shards == NULL || Q->tree == NULL){
+        fprintf(stderr, "Cannot allocate memory for table.");
+        exit(1);
+    }
+    for(size_t i=0; i<count; i++){
+        Q->shards[i].HT = newHTable_OA(cfg);
+        pthread_mutex_init(&Q->shards[i].lock, NULL);
+    }
+    //Todos los shards empiezan vacíos: las hojas sobrantes apuntan a "count" (nunca ganan)
+    for(size_t i=0; i<2*Q->leaves; i++)
+        Q->tree[i] = (i >= Q->leaves && i - Q->leaves < count) ? i - Q->leaves : count;
+    pthread_mutex_init(&Q->tree_lock, NULL);
+    return Q;
+}
+
+void freeShardedQuash(sharded_quash *Q){
+    for(size_t i=0; i<Q->count; i++){
+        freeHTable_OA(Q->shards[i].HT);
+        pthread_mutex_destroy(&Q->shards[i].lock);
+        free(Q->shards[i].min.bytes);
+    }
+    pthread_mutex_destroy(&Q->tree_lock);
+    free(Q->tree);
+    free(Q->shards);
+    free(Q);
+}
+
+/*Ganador entre dos shards del torneo*/
+static inline size_t tournamentWinner(sharded_quash *Q, size_t a, size_t b){
+    if(a == Q->count)
+        return b;
+    if(b == Q->count)
+        return a;
+    return keycmp(Q->cfg.numeric, &Q->shards[b].min, &Q->shards[a].min) == -1 ? b : a;
+}
+
+/*Se vuelve a jugar el camino de la hoja de un shard hasta la raíz (con tree_lock)*/
+static void replayTournament(sharded_quash *Q, size_t shard){
+    for(size_t i=(Q->leaves + shard)/2; i>=1; i/=2)
+        Q->tree[i] = tournamentWinner(Q, Q->tree[2*i], Q->tree[2*i+1]);
+}
+
+/*Toma la copia del mínimo actual de un shard (con el candado del shard)*/
+static void snapshotMin(quash_shard *S, shard_key *key){
+    heap *h = S->HT->h;
+    key->version = ++S->version;
+    key->present = NO;
+    if(h->index > 0)
+        copyKey(key, h, &h->array[heapTop(S->HT)]);
+}
+
+/*Publica en el torneo la copia del mínimo de un shard. Si otro hilo ya publicó una más nueva, no se hace nada*/
+//NOTA: Se toma tree_lock sin tener el candado del shard (el deleteMin global los toma en el orden contrario)
+static void publishMin(sharded_quash *Q, size_t shard, shard_key *key){
+    pthread_mutex_lock(&Q->tree_lock);
+    shard_key *min = &Q->shards[shard].min;
+    if(key->version > min->version){
+        unsigned char *bytes = min->bytes;
+        size_t cap = min->cap;
+        *min = *key;
+        //Se intercambian los buffers para no copiar otra vez los bytes
+        key->bytes = bytes;
+        key->cap = cap;
+        replayTournament(Q, shard);
+    }
+    pthread_mutex_unlock(&Q->tree_lock);
+}
+
+/*Raíz del heap de un shard, para saber si una operación cambió su mínimo*/
+//NOTA: El ref sólo identifica a la llave mientras la arena no se compacte: al compactar, otra llave puede quedar con el
+//... mismo desplazamiento y largo que la raíz anterior. Por eso también se guarda el número de compactaciones
+typedef struct {
+    int empty;
+    uint64_t ref;               //ref (o num) del mínimo
+    size_t compactions;         //stats.compactions del shard
+} shard_root;
+
+static inline shard_root rootOf(HTable_OA *HT){
+    shard_root r;
+    r.empty = HT->h->index == 0;
+    r.ref = r.empty ? 0 : HT->h->array[heapTop(HT)].ref;
+    r.compactions = HT->stats.compactions;
+    return r;
+}
+
+/*YES si el mínimo pudo cambiar entre "a" y "b" (ante una compactación se supone que sí)*/
+static inline int rootChanged(shard_root a, shard_root b){
+    return a.empty != b.empty || a.ref != b.ref || a.compactions != b.compactions;
+}
+
+/*Inserta un record. Regresa su multiplicidad después de insertarlo*/
+size_t shardedInsert(sharded_quash *Q, record *rec){
+    size_t shard = shardOf(Q, hashKey(Q->cfg.hash_type, rec));
+    quash_shard *S = &Q->shards[shard];
+    shard_key key = {0};
+    pthread_mutex_lock(&S->lock);
+    shard_root before = rootOf(S->HT);
+    size_t mult = quashInsert(&S->HT, rec);
+    int changed = rootChanged(before, rootOf(S->HT));
+    if(changed)
+        snapshotMin(S, &key);
+    pthread_mutex_unlock(&S->lock);
+    //Sólo si la llave quedó en la raíz del shard hay que avisarle al torneo
+    if(changed)
+        publishMin(Q, shard, &key);
+    free(key.bytes);
+    return mult;
+}
+
+/*Busca un record. Regresa su multiplicidad (0 si no está)*/
+size_t shardedLookup(sharded_quash *Q, record *rec){
+    quash_shard *S = &Q->shards[shardOf(Q, hashKey(Q->cfg.hash_type, rec))];
+    size_t mult = 0;
+    pthread_mutex_lock(&S->lock);
+    //NOTA: Con -i la búsqueda también muda un tramo de la tabla anterior, así que necesita el candado completo
+    migrateStep(S->HT, MIGRATE_STEP, S->HT->cfg.probing);
+    hash_item *item = HTfindRecord_OA(&S->HT, rec, S->HT->cfg.probing);
+    if(item != NULL)
+        mult = S->HT->h->array[item->heap_index].mult;
+    pthread_mutex_unlock(&S->lock);
+    return mult;
+}
+
+/*Borra un record. Regresa la multiplicidad que le queda (0 si se eliminó) o -1 si no estaba*/
+long shardedDelete(sharded_quash *Q, record *rec){
+    size_t shard = shardOf(Q, hashKey(Q->cfg.hash_type, rec));
+    quash_shard *S = &Q->shards[shard];
+    shard_key key = {0};
+    pthread_mutex_lock(&S->lock);
+    shard_root before = rootOf(S->HT);
+    long mult = quashDelete(&S->HT, rec);
+    //NOTA: Si la arena se compactó se publica aunque la llave de la raíz sea la misma (sólo se publica de más)
+    int changed = mult == 0 && rootChanged(before, rootOf(S->HT));
+    if(changed)
+        snapshotMin(S, &key);
+    pthread_mutex_unlock(&S->lock);
+    if(changed)
+        publishMin(Q, shard, &key);
+    free(key.bytes);
+    return mult;
+}
+
+/*Saca el mínimo global (igual que deleteMin: si su multiplicidad es mayor a 1 sólo se decrementa). Copia la llave en
+ * "out" y regresa la multiplicidad que le queda (0 si se eliminó) o -1 si el quash está vacío*/
+long shardedDeleteMin(sharded_quash *Q, shard_key *out){
+    pthread_mutex_lock(&Q->tree_lock);
+    while(1){
+        size_t shard = Q->tree[1];
+        if(shard == Q->count || !Q->shards[shard].min.present){
+            pthread_mutex_unlock(&Q->tree_lock);
+            out->present = NO;
+            return -1;
+        }
+        quash_shard *S = &Q->shards[shard];
+        pthread_mutex_lock(&S->lock);
+        pop_item item;
+        if(popK(&S->HT, 1, &item) == 0){
+            //La copia estaba atrasada (otro hilo vació el shard y todavía no la publica): se corrige y se juega otra vez
+            snapshotMin(S, &S->min);
+            replayTournament(Q, shard);
+            pthread_mutex_unlock(&S->lock);
+            continue;
+        }
+        copyKey(out, S->HT->h, &item.node);
+        long mult = item.node.mult;
+        shrinkHTable_OA(&S->HT, S->HT->cfg.probing);
+        //Se actualiza directamente la copia del mínimo (ya se tiene tree_lock)
+        if(mult == 0){
+            snapshotMin(S, &S->min);
+            replayTournament(Q, shard);
+        }
+        pthread_mutex_unlock(&S->lock);
+        pthread_mutex_unlock(&Q->tree_lock);
+        return mult;
+    }
+}
+
+/*Cantidad total de llaves distintas (suma de los shards)*/
+size_t shardedCount(sharded_quash *Q){
+    size_t total = 0;
+    for(size_t i=0; i<Q->count; i++){
+        pthread_mutex_lock(&Q->shards[i].lock);
+        total += Q->shards[i].HT->occupied_elements;
+        pthread_mutex_unlock(&Q->shards[i].lock);
+    }
+    return total;
+}
+
+/**************************MODO RELAJADO (MULTIQUEUE)*********************************************/
+//NOTA: Para muchos consumidores el mínimo exacto es un solo punto de contención (el árbol de torneo y el shard que
+//... gana). En modo relajado cada shard hace de una de las colas de una MultiQueue: se eligen dos shards al azar, se
+//... toman con trylock (si alguno está ocupado se eligen otros) y se saca el menor de sus dos mínimos
+//NOTA 2: Las llaves no van a una cola al azar sino a la de su llave hash (para distintas llaves es igual de aleatorio)
+//... y así cada llave vive en un solo shard: las búsquedas y las multiplicidades siguen siendo exactas
+//Garantía (Rihani, Sanders y Dementiev): con m = c*P colas y llaves repartidas al azar, el rango esperado de la llave
+//... que saca un deleteMin relajado (0 = el mínimo global) es O(m), y O(m log m) con alta probabilidad. Nunca se
+//... saca una llave que no esté en el quash ni se pierde ninguna
+#define MQ_FACTOR 2             //c: colas (shards) por hilo
+#define MQ_TRIES 8              //Intentos con pares al azar antes de pasar al deleteMin exacto
+
+/*Función para crear un quash para el modo relajado con MQ_FACTOR shards por hilo*/
+sharded_quash* newMultiQueue(size_t threads, HTconfig cfg){
+    return newShardedQuash(MQ_FACTOR*(threads > 0 ? threads : 1), cfg);
+}
+
+/*Generador pseudoaleatorio (xorshift64) de cada hilo para elegir las colas*/
+static inline size_t mqRandom(size_t count){
+    static _Thread_local uint64_t state = 0;
+    if(state == 0)
+        state = (uint64_t)(uintptr_t)&state * 0x9E3779B97F4A7C15ull | 1;
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return ((state >> 32) * count) >> 32;
+}
+
+/*Compara los mínimos de dos shards (con sus candados tomados; un heap vacío es mayor que cualquiera)*/
+static int rootcmp(quash_shard *A, quash_shard *B){
+    heap *a = A->HT->h, *b = B->HT->h;
+    if(a->index == 0 || b->index == 0)
+        return (a->index == 0) - (b->index == 0);
+    heap_item *x = &a->array[heapTop(A->HT)], *y = &b->array[heapTop(B->HT)];
+    if(a->numeric)
+        return (x->num > y->num) - (x->num < y->num);
+    return reccmp(heapRecord(a, x), heapRecord(b, y));
+}
+
+/*deleteMin relajado: saca el mínimo de uno de dos shards al azar. Copia la llave en "out" y regresa la multiplicidad
+ * que le queda (0 si se eliminó) o -1 si el quash está vacío*/
+//NOTA: Si los intentos fallan (shards ocupados o vacíos) se usa shardedDeleteMin, que también detecta el quash vacío
+long shardedRelaxedDeleteMin(sharded_quash *Q, shard_key *out){
+    for(int attempt=0; attempt<MQ_TRIES; attempt++){
+        size_t i = mqRandom(Q->count), j = mqRandom(Q->count);
+        quash_shard *A = &Q->shards[i], *B = &Q->shards[j];
+        if(pthread_mutex_trylock(&A->lock) != 0)
+            continue;
+        if(i != j && pthread_mutex_trylock(&B->lock) != 0){
+            pthread_mutex_unlock(&A->lock);
+            continue;
+        }
+        //Se queda con el shard del menor de los dos mínimos y suelta el otro
+        size_t shard = i;
+        if(i != j){
+            if(rootcmp(B, A) == -1){
+                shard = j;
+                pthread_mutex_unlock(&A->lock);
             }
+            else
+                pthread_mutex_unlock(&B->lock);
+        }
+        quash_shard *S = &Q->shards[shard];
+        pop_item item;
+        if(popK(&S->HT, 1, &item) == 0){
+            pthread_mutex_unlock(&S->lock);
             continue;
         }
-        if(strcmp("exit", command)==0)                  //salir
+        copyKey(out, S->HT->h, &item.node);
+        long mult = item.node.mult;
+        shrinkHTable_OA(&S->HT, S->HT->cfg.probing);
+        //Si cambió el mínimo del shard, se publica para que el deleteMin exacto siga siendo correcto
+        shard_key key = {0};
+        if(mult == 0)
+            snapshotMin(S, &key);
+        pthread_mutex_unlock(&S->lock);
+        if(mult == 0)
+            publishMin(Q, shard, &key);
+        free(key.bytes);
+        return mult;
+    }
+    return shardedDeleteMin(Q, out);
+}
+
+/*Función para traducir el nombre de un sondeo ("lp", "qp", "dh", "rh" o "sw") a su constante (0 si no existe)*/
+int probingMode(const char *name){
+    const char *names[] = {"lp", "qp", "dh", "rh", "sw"};
+    const int modes[] = {LP, QP, DH, RH, SW};
+    for(int i=0; i<5; i++){
+        if(strcmp(names[i], name)==0)
+            return modes[i];
+    }
+    return 0;
+}
+
+/**************************LECTURA DE COMANDOS******************************/
+//NOTA: La entrada se lee en bloques grandes (o se mapea completa si es un archivo) y se recorre una sola vez: cada
+//... línea se parte en palabras sin copiarlas y los records de las llaves apuntan directamente al bloque leído
+//NOTA 2: Con "-b" la entrada es binaria: cada operación es [código (1 byte)][largo de la llave (2 bytes, little
+//... endian)][bytes de la llave]; "update" lleva después una segunda llave con su largo. En modo numérico la llave son
+//... los 8 bytes del int64_t (little endian) y en "deleteMin" la llave, si la hay, es k como uint64_t
+#define INPUT_CHUNK (1 << 20)   //Tamaño inicial del bloque de lectura (crece si una línea no cabe)
+
+/*Función para traducir el nombre de un comando a su código (OP_NONE si no existe)*/
+//NOTA: Se revisa primero el largo, así que cada palabra se compara a lo más con cuatro nombres
+static inline int commandCode(const char *word, size_t len){
+    switch(len){
+    case 4:
+        if(memcmp(word, "stop", 4)==0) return OP_STOP;
+        if(memcmp(word, "exit", 4)==0) return OP_EXIT;
+        if(memcmp(word, "load", 4)==0) return OP_LOAD;
+        break;
+    case 5:
+        if(memcmp(word, "print", 5)==0) return OP_PRINT;
+        if(memcmp(word, "stats", 5)==0) return OP_STATS;
+        break;
+    case 7:
+        if(memcmp(word, "restore", 7)==0) return OP_RESTORE;
+        break;
+    case 8:
+        if(memcmp(word, "snapshot", 8)==0) return OP_SNAPSHOT;
+        break;
+    case 6:
+        if(memcmp(word, "insert", 6)==0) return OP_INSERT;
+        if(memcmp(word, "delete", 6)==0) return OP_DELETE;
+        if(memcmp(word, "lookup", 6)==0) return OP_LOOKUP;
+        if(memcmp(word, "update", 6)==0) return OP_UPDATE;
+        break;
+    case 9:
+        if(memcmp(word, "deleteMin", 9)==0) return OP_DELETEMIN;
+        break;
+    }
+    return OP_NONE;
+}
+
+/*Operaciones cuyo argumento es la ruta de un archivo*/
+static inline int takesPath(int op){
+    return op == OP_LOAD || op == OP_SNAPSHOT || op == OP_RESTORE || op == OP_RESTORE_SUM;
+}
+
+/*Entero decimal (con signo opcional) de una palabra. Regresa NO si la palabra no es sólo dígitos (después del signo)
+ * o si el valor no cabe en int64_t*/
+static inline int parseInt(const char *word, size_t len, int64_t *out){
+    size_t i = 0;
+    int negative = 0;
+    if(len > 0 && (word[0] == '-' || word[0] == '+')){
+        negative = word[0] == '-';
+        i++;
+    }
+    if(i == len)
+        return NO;
+    //El negativo puede llegar a 2^63 (INT64_MIN); el positivo, a 2^63 - 1
+    uint64_t limit = (uint64_t)INT64_MAX + negative, value = 0;
+    for(; i<len; i++){
+        if(word[i] < '0' || word[i] > '9')
+            return NO;
+        uint64_t digit = (uint64_t)(word[i] - '0');
+        if(value > (limit - digit)/10)
+            return NO;
+        value = value*10 + digit;
+    }
+    *out = negative ? (int64_t)(0 - value) : (int64_t)value;
+    return YES;
+}
+
+/*Mensaje de una llave que no es un entero válido en modo numérico (la operación no se hace)*/
+static void badNumber(HTable_OA *HT, const char *word, size_t len){
+    outFlush(&HT->out);
+    fprintf(stderr, "Entero no valido: %.*s\n", (int)len, word);
+}
+
+/*Función para ejecutar una operación ya separada. "count" apunta a la k de "deleteMin k" (NULL = deleteMin normal) y
+ * "path" a la ruta de las operaciones con archivo (NULL en las demás). Regresa NO si la operación fue "exit"*/
+int runCommand(HTable_OA **HT, int op, record *rec, record *rec2, const size_t *count, const char *path){
+    //Las operaciones que modifican el quash se agregan al journal (si hay uno) antes de ejecutarse
+    journal *J = &(*HT)->wal;
+    if(J->fd >= 0){
+        uint64_t k = count ? *count : 0;
+        record arg = {&k, count ? sizeof(uint64_t) : 0};
+        record file = {(void*)path, path ? strlen(path) : 0};
+        switch(op){
+        case OP_INSERT: case OP_DELETE:
+            journalAppend(J, op, rec, NULL);
+            break;
+        case OP_UPDATE:
+            journalAppend(J, op, rec, rec2);
+            break;
+        case OP_DELETEMIN:
+            journalAppend(J, op, &arg, NULL);
             break;
+        //"load" guarda sus llaves en LoadElements. De "restore" se guarda la suma del snapshot (si no se puede leer,
+        //... el restore tampoco se hará y no se guarda nada)
+        case OP_RESTORE:{
+            uint64_t sum;
+            record sum_rec = {&sum, sizeof(uint64_t)};
+            if(file.len > 0 && fileChecksum(path, &sum) == YES)
+                journalAppend(J, OP_RESTORE_SUM, &file, &sum_rec);
+            break;
+        }
+        case OP_RESTORE_SUM:
+            journalAppend(J, op, &file, rec2);
+            break;
+        }
     }
+    switch(op){
+    case OP_INSERT:                             //insertar
+        InsertElement(HT, rec);
+        break;
+    case OP_DELETE:                             //borrar
+        DeleteElement(HT, rec);
+        break;
+    case OP_UPDATE:                             //Cambiar una llave por otra (conserva su multiplicidad)
+        UpdateElement(HT, rec, rec2);
+        break;
+    case OP_LOOKUP:                             //Encontrar un elemento
+        LookUpElement(HT, rec);
+        break;
+    case OP_DELETEMIN:                          //Borrar el elemento menor (o los k menores con "deleteMin k")
+        if(count == NULL)
+            deleteMin(HT);
+        else
+            deleteMinK(HT, *count);
+        break;
+    case OP_PRINT:                              //imprimir
+        print_Heap(*HT);
+        break;
+    case OP_STATS:                              //Estadísticas de la estructura
+        StatsElements(HT);
+        break;
+    case OP_LOAD:                               //Carga masiva desde un archivo
+        LoadElements(HT, path);
+        break;
+    case OP_SNAPSHOT:                           //Guardar el quash en un archivo
+        SnapshotElements(HT, path);
+        break;
+    case OP_RESTORE:                            //Reemplazar el quash por el de un snapshot
+        RestoreElements(HT, path);
+        break;
+    case OP_RESTORE_SUM:{                       //Lo mismo, si el snapshot no cambió desde que se guardó la operación
+        uint64_t sum, expected = 0;
+        if(rec2->len == sizeof(uint64_t))
+            memcpy(&expected, rec2->bytes, sizeof(uint64_t));
+        if(rec2->len != sizeof(uint64_t) || fileChecksum(path, &sum) == NO || sum != expected){
+            outFlush(&(*HT)->out);
+            fprintf(stderr, "El snapshot %s no existe o cambio\n", path);
+            if(J->replay)
+                exit(1);
+            break;
+        }
+        RestoreElements(HT, path);
+        break;
+    }
+    case OP_STOP:{                              //Parar (crea un ciclo infinito para medir memoria en servidor)
+        outFlush(&(*HT)->out);
+        size_t i = 0;
+        while(i<1){
+            continue;
+        }
+        break;
+    }
+    case OP_EXIT:                               //salir
+        return NO;
+    }
+    return YES;
+}
+
+/*Función para ejecutar las líneas completas de un bloque de texto. Si "last" es YES, también la última aunque no
+ * termine en salto de línea. Regresa cuántos bytes se usaron (y "done" = YES si apareció "exit")*/
+size_t runText(HTable_OA **HT, const char *text, size_t len, int last, int *done){
+    int numeric = (*HT)->cfg.numeric;
+    size_t pos = 0;
+    while(pos < len){
+        const char *end = (const char*)memchr(text + pos, '\n', len - pos);
+        if(end == NULL && !last)
+            break;
+        size_t line_end = end ? (size_t)(end - text) : len;
+        //Se parte la línea en hasta tres palabras (comando, llave y segunda llave)
+        const char *word[3];
+        size_t word_len[3] = {0, 0, 0};
+        int words = 0;
+        size_t i = pos;
+        while(i < line_end && words < 3){
+            while(i < line_end && (text[i] == ' ' || text[i] == '\t' || text[i] == '\r'))
+                i++;
+            if(i == line_end)
+                break;
+            word[words] = text + i;
+            while(i < line_end && text[i] != ' ' && text[i] != '\t' && text[i] != '\r')
+                i++;
+            word_len[words] = text + i - word[words];
+            words++;
+        }
+        pos = line_end + 1;
+        if(words == 0)
+            continue;
+        int op = commandCode(word[0], word_len[0]);
+        if(op == OP_NONE)
+            continue;
+        //Las llaves apuntan al bloque (en modo numérico se convierten una sola vez a int64_t)
+        record rec = {NULL, 0}, rec2 = {NULL, 0};
+        int64_t num = 0, num2 = 0;
+        //Las operaciones con llave se ignoran si no la traen ("update" necesita las dos)
+        int keys = (op == OP_INSERT || op == OP_DELETE || op == OP_LOOKUP) ? 1 : (op == OP_UPDATE) ? 2 : 0;
+        if(words < 1 + keys)
+            continue;
+        if(keys > 0){
+            if(numeric){
+                if(parseInt(word[1], word_len[1], &num) == NO){
+                    badNumber(*HT, word[1], word_len[1]);
+                    continue;
+                }
+                rec.bytes = &num;
+                rec.len = sizeof(int64_t);
+            }
+            else{
+                rec.bytes = (void*)word[1];
+                rec.len = word_len[1];
+            }
+        }
+        if(keys > 1){
+            if(numeric){
+                if(parseInt(word[2], word_len[2], &num2) == NO){
+                    badNumber(*HT, word[2], word_len[2]);
+                    continue;
+                }
+                rec2.bytes = &num2;
+                rec2.len = sizeof(int64_t);
+            }
+            else{
+                rec2.bytes = (void*)word[2];
+                rec2.len = word_len[2];
+            }
+        }
+        //"deleteMin k": k debe ser un entero no negativo
+        int64_t k = 0;
+        if(op == OP_DELETEMIN && words > 1 && (parseInt(word[1], word_len[1], &k) == NO || k < 0)){
+            badNumber(*HT, word[1], word_len[1]);
+            continue;
+        }
+        size_t count = (size_t)k;
+        const size_t *batch = (op == OP_DELETEMIN && words > 1) ? &count : NULL;
+        //La ruta de "load", "snapshot" y "restore" es el resto de la línea (se copia para terminarla en '\0')
+        //NOTA: El buffer no se inicializa: sólo se escribe (y se pasa a runCommand) en las operaciones con ruta
+        char path[4096];
+        if(takesPath(op))
+            path[0] = '\0';
+        if(takesPath(op) && words > 1){
+            const char *path_end = text + line_end;
+            while(path_end > word[1] && (path_end[-1] == ' ' || path_end[-1] == '\t' || path_end[-1] == '\r'))
+                path_end--;
+            size_t path_len = path_end - word[1];
+            if(path_len >= sizeof(path))
+                path_len = sizeof(path) - 1;
+            memcpy(path, word[1], path_len);
+            path[path_len] = '\0';
+        }
+        if(runCommand(HT, op, &rec, &rec2, batch, takesPath(op) ? path : NULL) == NO){
+            *done = YES;
+            return pos > len ? len : pos;
+        }
+    }
+    return pos > len ? len : pos;
+}
+
+/*Largo (2 bytes, little endian) de una llave del protocolo binario*/
+static inline size_t binaryLength(const unsigned char *p){
+    return (size_t)p[0] | ((size_t)p[1] << 8);
+}
+
+/*Función para ejecutar las operaciones completas de un bloque binario. Regresa cuántos bytes se usaron (y "done" = YES
+ * si apareció OP_EXIT)*/
+size_t runBinary(HTable_OA **HT, const unsigned char *data, size_t len, int *done){
+    size_t pos = 0;
+    while(pos + 3 <= len){
+        int op = data[pos];
+        size_t key_len = binaryLength(data + pos + 1);
+        size_t next = pos + 3 + key_len;
+        if(next > len)
+            break;
+        //Las llaves se usan tal cual están en el bloque (en modo numérico ya son los 8 bytes del int64_t)
+        record rec = {(void*)(data + pos + 3), key_len}, rec2 = {NULL, 0};
+        if(op == OP_UPDATE || op == OP_RESTORE_SUM){
+            if(next + 2 > len)
+                break;
+            size_t second_len = binaryLength(data + next);
+            if(next + 2 + second_len > len)
+                break;
+            rec2.bytes = (void*)(data + next + 2);
+            rec2.len = second_len;
+            next += 2 + second_len;
+        }
+        size_t count = 0;
+        const size_t *batch = NULL;
+        if(op == OP_DELETEMIN && key_len == sizeof(uint64_t)){
+            memcpy(&count, rec.bytes, sizeof(uint64_t));
+            batch = &count;
+        }
+        char path[4096];
+        if(takesPath(op)){
+            size_t path_len = key_len < sizeof(path) ? key_len : sizeof(path) - 1;
+            memcpy(path, rec.bytes, path_len);
+            path[path_len] = '\0';
+        }
+        pos = next;
+        //En modo numérico una llave que no mide 8 bytes no es válida
+        if((*HT)->cfg.numeric && (op == OP_INSERT || op == OP_DELETE || op == OP_LOOKUP || op == OP_UPDATE) &&
+           (rec.len != sizeof(int64_t) || (op == OP_UPDATE && rec2.len != sizeof(int64_t))))
+            continue;
+        if(runCommand(HT, op, &rec, &rec2, batch, takesPath(op) ? path : NULL) == NO){
+            *done = YES;
+            return pos;
+        }
+    }
+    return pos;
+}
+
+/*Función para ejecutar todos los comandos de un descriptor (texto o binario). Si es un archivo se mapea completo; si
+ * no (tubería o terminal), se lee en bloques y lo que quede de una línea incompleta pasa al siguiente bloque*/
+void runStream(HTable_OA **HT, int fd, int binary){
+    int done = NO;
+    struct stat st;
+    if(fstat(fd, &st)==0 && S_ISREG(st.st_mode) && st.st_size > 0){
+        void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(data != MAP_FAILED){
+            madvise(data, st.st_size, MADV_SEQUENTIAL);
+            if(binary)
+                runBinary(HT, (const unsigned char*)data, st.st_size, &done);
+            else
+                runText(HT, (const char*)data, st.st_size, YES, &done);
+            munmap(data, st.st_size);
+            return;
+        }
+    }
+    size_t cap = INPUT_CHUNK, used = 0;
+    char *buffer = (char*)malloc(cap);
+    if(buffer == NULL){
+        fprintf(stderr, "Error en malloc!\n");
+        exit(1);
+    }
+    while(!done){
+        //Si el bloque se llenó con una sola línea (u operación) incompleta, se duplica
+        if(used == cap){
+            cap *= 2;
+            buffer = (char*)realloc(buffer, cap);
+            if(buffer == NULL){
+                fprintf(stderr, "Error en malloc!\n");
+                exit(1);
+            }
+        }
+        //Antes de esperar más entrada se escriben los mensajes (y antes que ellos, el grupo pendiente del journal: en
+        //... una terminal, cada respuesta aparece, ya guardada en el journal, antes de leer el siguiente comando)
+        outFlush(&(*HT)->out);
+        ssize_t got = read(fd, buffer + used, cap - used);
+        if(got < 0 && errno == EINTR)
+            continue;
+        int last = got <= 0;
+        if(got > 0)
+            used += got;
+        size_t consumed = binary ? runBinary(HT, (const unsigned char*)buffer, used, &done)
+                                 : runText(HT, buffer, used, last, &done);
+        memmove(buffer, buffer + consumed, used - consumed);
+        used -= consumed;
+        if(last)
+            break;
+    }
+    free(buffer);
+}
+
+/*Función para abrir el journal "path": primero se reproducen sus operaciones (sin imprimir nada) y después se agregan
+ * ahí las nuevas. Si la última operación quedó incompleta (el programa se cayó al escribirla), se descarta*/
+void openJournal(HTable_OA **HT, const char *path, size_t group, long interval_ms){
+    int fd = open(path, O_RDWR | O_CREAT | O_APPEND, 0644);
+    struct stat st;
+    if(fd < 0 || fstat(fd, &st) != 0){
+        fprintf(stderr, "No se pudo abrir el journal %s\n", path);
+        exit(1);
+    }
+    size_t valid = 0;
+    if(st.st_size > 0){
+        void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(data == MAP_FAILED){
+            fprintf(stderr, "No se pudo leer el journal %s\n", path);
+            exit(1);
+        }
+        //Se reproduce en modo silencioso y sin contar los resultados (no son de esta sesión)
+        out_counts count = (*HT)->out.count;
+        int output = (*HT)->cfg.output;
+        int done = NO;
+        (*HT)->cfg.output = OUT_QUIET;
+        (*HT)->wal.replay = YES;
+        valid = runBinary(HT, (const unsigned char*)data, st.st_size, &done);
+        (*HT)->wal.replay = NO;
+        (*HT)->cfg.output = output;
+        (*HT)->out.count = count;
+        munmap(data, st.st_size);
+    }
+    if(valid < (size_t)st.st_size && ftruncate(fd, valid) != 0){
+        fprintf(stderr, "No se pudo escribir el journal %s\n", path);
+        exit(1);
+    }
+    journal *J = &(*HT)->wal;
+    J->fd = fd;
+    J->path = strdup(path);
+    if(J->path == NULL){
+        fprintf(stderr, "Error en malloc!\n");
+        exit(1);
+    }
+    J->group = group > 0 ? group : 1;
+    J->interval = interval_ms*1000000L;
+}
+
+/**************************MAIN******************************/
+//NOTA: Los benchmarks incluyen este archivo definiendo QUASH_NO_MAIN para reutilizar las estructuras sin el intérprete
+#ifndef QUASH_NO_MAIN
+int main(int argc, char *argv[]){
+    HTconfig cfg = {H_WY, NO, NO, DH, OUT_VERBOSE, NO, 0, 0, 0, HUGE_THP, ENGINE_HEAP};
+    int binary = NO;
+    const char *journal_path = NULL, *snapshot_path = NULL;
+    size_t group = JOURNAL_GROUP;
+    long interval = JOURNAL_INTERVAL;
+    //Opciones de línea de comandos: "-n" activa el modo numérico (cada llave se convierte una sola vez a int64_t),
+    //... "-i" el remodelado incremental de la tabla, "-p <sondeo>" elige el sondeo (lp, qp, dh, rh o sw; dh por
+    //... defecto), "-b" lee las operaciones en el protocolo binario, "-q" no imprime el resultado de cada
+    //... operación y "-s" tampoco, pero al final imprime cuántos resultados hubo de cada tipo
+    //Para no perder datos: "-r <snapshot>" empieza desde un snapshot y "-j <journal>" reproduce y después guarda ahí las
+    //... operaciones que modifican el quash ("-g <ops>" y "-t <ms>" eligen cuándo se escribe cada grupo). El comando
+    //... "snapshot" vacía el journal y lo deja empezando con ese snapshot, así que basta "-j" para reiniciar (si el
+    //... snapshot ya no existe o cambió, el journal no se reproduce)
+    //Tamaños de la tabla: "-2" usa potencias de dos (máscara en vez de módulo) y "-L <max>,<min>,<histéresis>" cambia
+    //... la política de carga (porcentajes de carga para crecer y para reducir, y lo que sube "hist" en cada reducción)
+    //"-H <modo>" elige las páginas de la tabla y del heap: off (malloc), thp (páginas grandes transparentes, por defecto)
+    //... o explicit (MAP_HUGETLB, con páginas reservadas por el administrador)
+    //"-f <familia>" elige la función hash: wy (por defecto) o adler (adler32, la original, por compatibilidad)
+    //"-e <motor>" elige la estructura de prioridad: heap (por defecto) o radix (sólo con -n; conviene cuando los mínimos
+    //... extraídos nunca decrecen, como en un simulador de eventos)
+    for(int i=1; i<argc; i++){
+        if(strcmp("-2", argv[i])==0)
+            cfg.pow2 = YES;
+        if(strcmp("-L", argv[i])==0 && i+1 < argc){
+            if(sscanf(argv[++i], "%d,%d,%d", &cfg.max_load, &cfg.min_load, &cfg.hysteresis) < 1 ||
+               cfg.max_load < 1 || cfg.max_load > 95 || cfg.min_load < 0 ||
+               (cfg.min_load > 0 ? cfg.min_load : 10)*2 >= cfg.max_load){
+                fprintf(stderr, "Politica de carga no valida (usa -L max,min,histeresis con 0 < 2*min < max <= 95)\n");
+                exit(1);
+            }
+        }
+        if(strcmp("-H", argv[i])==0){
+            const char *mode = (i+1 < argc) ? argv[++i] : "";
+            cfg.huge = strcmp(mode, "off")==0 ? HUGE_OFF : strcmp(mode, "thp")==0 ? HUGE_THP :
+                       strcmp(mode, "explicit")==0 ? HUGE_EXPLICIT : -1;
+            if(cfg.huge < 0){
+                fprintf(stderr, "Paginas no validas (usa -H off|thp|explicit)\n");
+                exit(1);
+            }
+        }
+        if(strcmp("-f", argv[i])==0){
+            const char *family = (i+1 < argc) ? argv[++i] : "";
+            cfg.hash_type = strcmp(family, "wy")==0 ? H_WY : strcmp(family, "adler")==0 ? H_ADLER : -1;
+            if(cfg.hash_type < 0){
+                fprintf(stderr, "Familia hash no valida (usa -f adler|wy)\n");
+                exit(1);
+            }
+        }
+        if(strcmp("-e", argv[i])==0){
+            const char *engine = (i+1 < argc) ? argv[++i] : "";
+            cfg.engine = strcmp(engine, "heap")==0 ? ENGINE_HEAP : strcmp(engine, "radix")==0 ? ENGINE_RADIX : -1;
+            if(cfg.engine < 0){
+                fprintf(stderr, "Motor no valido (usa -e heap|radix)\n");
+                exit(1);
+            }
+        }
+        if(strcmp("-j", argv[i])==0 && i+1 < argc)
+            journal_path = argv[++i];
+        if(strcmp("-r", argv[i])==0 && i+1 < argc)
+            snapshot_path = argv[++i];
+        if(strcmp("-g", argv[i])==0 && i+1 < argc)
+            group = strtoull(argv[++i], NULL, 10);
+        if(strcmp("-t", argv[i])==0 && i+1 < argc)
+            interval = strtol(argv[++i], NULL, 10);
+        if(strcmp("-b", argv[i])==0)
+            binary = YES;
+        if(strcmp("-q", argv[i])==0)
+            cfg.output = OUT_QUIET;
+        if(strcmp("-s", argv[i])==0)
+            cfg.output = OUT_SUMMARY;
+        if(strcmp("-n", argv[i])==0)
+            cfg.numeric = YES;
+        if(strcmp("-i", argv[i])==0)
+            cfg.incremental = YES;
+        if(strcmp("-p", argv[i])==0){
+            cfg.probing = (i+1 < argc) ? probingMode(argv[++i]) : 0;
+            if(cfg.probing == 0){
+                fprintf(stderr, "Sondeo no valido (usa -p lp|qp|dh|rh|sw)\n");
+                exit(1);
+            }
+        }
+    }
+    //Con QP y tamaños primos sólo la mitad de las casillas están en el recorrido: la carga no puede pasar del 50%. Lo
+    //... mismo con DH, cuyos saltos acumulados son múltiplos del paso por los números triangulares
+    if((cfg.probing == QP || cfg.probing == DH) && !cfg.pow2 && cfg.max_load > 50){
+        fprintf(stderr, "Con -p qp o -p dh (sin -2) la carga maxima es 50\n");
+        exit(1);
+    }
+    if(cfg.engine == ENGINE_RADIX && !cfg.numeric){
+        fprintf(stderr, "El motor radix requiere el modo numerico (-n)\n");
+        exit(1);
+    }
+    HTable_OA *quash = newHTable_OA(cfg);
+    if(snapshot_path != NULL && restoreSnapshot(quash, snapshot_path) == NO){
+        fprintf(stderr, "No se pudo restaurar el snapshot %s\n", snapshot_path);
+        exit(1);
+    }
+    if(journal_path != NULL)
+        openJournal(&quash, journal_path, group, interval);
+    runStream(&quash, STDIN_FILENO, binary);
+    if(cfg.output == OUT_SUMMARY)
+        outSummary(&quash->out);
+    outText(&quash->out, "¡Gracias!\n");
     freeHTable_OA(quash);
-    printf("¡Gracias!\n"); 
     return 0;
-}
\ No newline at end of file
+}
+#endif
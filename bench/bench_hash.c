@@ -0,0 +1,215 @@
+//QUASH - Benchmark de familias hash: colisiones y longitud de sondeo (adler32 vs. mezclador de 64 bits)
+//... con cada tipo de sondeo (lp, qp, dh, rh, sw), antes y después de n ciclos de borrar/insertar (churn)
+//NOTA: LP, QP, DH y RH usan una tabla con carga menor al 50%; SW, la menor tabla con carga de hasta 7/8
+//Compilación: gcc -O2 -pthread -o bench_hash bench/bench_hash.c      (con -DHASH_BITS=64 se guardan llaves de 64 bits)
+//Uso: ./bench_hash [n] [sondeos] [pow2]      (n = cantidad de llaves por conjunto, por defecto 100000; sondeos
+//... separados por comas, por defecto "lp,qp,dh,rh,sw"; con "pow2" las tablas son potencias de dos)
+#define QUASH_NO_MAIN
+#include "../Quash.c"
+
+/*Conjuntos de llaves a comparar*/
+#define KEYS_NUMERIC 0
+#define KEYS_RANDOM 1
+
+/*Generador pseudoaleatorio (xorshift64) para que las corridas sean reproducibles*/
+static uint64_t rng_state = 0x9e3779b97f4a7c15ull;
+static inline uint64_t rng(){
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+/*Llena "rec" con una llave del conjunto elegido (enteros de 3 a 12 cifras o bytes aleatorios de 8 a 24)*/
+static void makeKey(int set, unsigned char *buffer, record *rec){
+    size_t len;
+    if(set == KEYS_NUMERIC){
+        len = 3 + rng()%10;
+        buffer[0] = '1' + rng()%9;
+        for(size_t i=1; i<len; i++)
+            buffer[i] = '0' + rng()%10;
+    }
+    else{
+        len = 8 + rng()%17;
+        for(size_t i=0; i<len; i++)
+            buffer[i] = (unsigned char)rng();
+    }
+    rec->bytes = buffer;
+    rec->len = len;
+}
+
+/*Cuenta los pasos de sondeo que se necesitan para llegar al record (misma secuencia que DHFindKey o RHFindKey)*/
+static size_t probeLength(HTable_OA *HT, record *rec){
+    hash_t key = hashRecord(HT, rec);
+    size_t index = hashFunction(key, HT->size);
+    if(HT->cfg.probing == RH){
+        hash_item *item = HTfindRecord_OA(&HT, rec, RH);
+        return RHDisplacement(&HT->meta[item - HT->table], item - HT->table, HT->size);
+    }
+    //Con LP y QP se cuentan los pasos hasta la casilla del record
+    if(HT->cfg.probing == LP || HT->cfg.probing == QP){
+        hash_item *item = HTfindRecord_OA(&HT, rec, HT->cfg.probing);
+        size_t target = item - HT->table, i = 0;
+        for(size_t at = index; at != target; at = probeNext(HT->cfg.probing, index, at, i, HT->size))
+            i++;
+        return i;
+    }
+    //Con SW se cuentan los grupos (de GROUP bytes de control) que se revisan después del primero
+    if(HT->cfg.probing == SW){
+        hash_item *item = HTfindRecord_OA(&HT, rec, SW);
+        return ((item - HT->table) + HT->size - index) % HT->size / GROUP;
+    }
+    size_t Hash2 = DHStep(key, HT->size, HT->index_size);
+    size_t i = 0;
+    while(matchIndex(HT, HT->meta, HT->table, index, key, rec) == NO){
+        i++;
+        index = hashFunction((index + i*Hash2), HT->size);
+    }
+    return i;
+}
+
+static int cmpKeys(const void *a, const void *b){
+    hash_t x = *(const hash_t*)a, y = *(const hash_t*)b;
+    return (x > y) - (x < y);
+}
+
+static double seconds(){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec*1e-9;
+}
+
+/*Longitud de sondeo promedio y máxima de las búsquedas exitosas*/
+static double probeStats(HTable_OA *HT, record *recs, size_t distinct, size_t *max){
+    size_t total = 0;
+    *max = 0;
+    for(size_t i=0; i<distinct; i++){
+        size_t p = probeLength(HT, &recs[i]);
+        total += p;
+        if(p > *max)
+            *max = p;
+    }
+    return (double)total/distinct;
+}
+
+/*Tiempo total de buscar todas las llaves insertadas*/
+static double lookupAll(HTable_OA *HT, record *recs, size_t distinct){
+    double t0 = seconds();
+    for(size_t i=0; i<distinct; i++){
+        if(HTfindRecord_OA(&HT, &recs[i], HT->cfg.probing) == NULL){
+            fprintf(stderr, "llave %zu no encontrada\n", i);
+            exit(1);
+        }
+    }
+    return seconds() - t0;
+}
+
+static const char* probeName(int probing){
+    switch(probing){
+    case LP: return "lp";
+    case QP: return "qp";
+    case RH: return "rh";
+    case SW: return "sw";
+    default: return "dh";
+    }
+}
+
+static void run(int set, int hash_type, int probing, int pow2, size_t n){
+    //Se reserva una tabla con la carga máxima del sondeo para que no crezca durante la prueba
+    HTconfig cfg = {hash_type, NO, NO, probing, OUT_QUIET, pow2, 0, 0, 0, HUGE_THP, ENGINE_HEAP};
+    size_t index = 0;
+    while(loadLimit(&cfg, tableSize(&cfg, index)) <= n)
+        index++;
+    HTable_OA *HT = newHTableCap_OA(index, cfg);
+
+    unsigned char (*keys)[32] = malloc(32*n);
+    record *recs = malloc(sizeof(record)*n);
+    hash_t *hashes = malloc(sizeof(hash_t)*n);
+    char *home = calloc(HT->size, 1);
+    size_t distinct = 0, key_collisions = 0, home_collisions = 0;
+
+    //Se generan las llaves siempre con la misma semilla (cada familia ve exactamente los mismos datos)
+    rng_state = 0x9e3779b97f4a7c15ull + set;
+    double t0 = seconds();
+    for(size_t i=0; i<n; i++){
+        makeKey(set, keys[distinct], &recs[distinct]);
+        size_t before = HT->occupied_elements;
+        HTinsertRecord_OA(&HT, &recs[distinct], probing);
+        if(HT->occupied_elements > before)
+            distinct++;
+    }
+    double t_insert = seconds() - t0;
+
+    //Colisiones de llave completa (HASH_BITS bits) y de casilla inicial
+    for(size_t i=0; i<distinct; i++){
+        hashes[i] = hashRecord(HT, &recs[i]);
+        size_t slot = hashFunction(hashes[i], HT->size);
+        if(home[slot])
+            home_collisions++;
+        home[slot] = 1;
+    }
+    //Para contar llaves repetidas se ordena una copia
+    qsort(hashes, distinct, sizeof(hash_t), cmpKeys);
+    for(size_t i=1; i<distinct; i++)
+        if(hashes[i] == hashes[i-1])
+            key_collisions++;
+
+    //Longitud de sondeo y tiempo de búsquedas exitosas con la tabla recién llenada
+    size_t max;
+    double t_lookup = lookupAll(HT, recs, distinct);
+    double avg = probeStats(HT, recs, distinct, &max);
+
+    //Churn: n veces se borra una llave al azar y se inserta una nueva (la ocupación no cambia)
+    for(size_t i=0; i<n; i++){
+        size_t j = rng()%distinct;
+        HTdeleteRecordOA(&HT, &recs[j], probing);
+        do{
+            makeKey(set, keys[j], &recs[j]);
+        }while(HTfindRecord_OA(&HT, &recs[j], probing) != NULL);
+        HTinsertRecord_OA(&HT, &recs[j], probing);
+    }
+    size_t max_churn;
+    double t_churn = lookupAll(HT, recs, distinct);
+    double avg_churn = probeStats(HT, recs, distinct, &max_churn);
+
+    printf("%-8s %-6s %-3s %8zu %8zu %10zu %10zu %8.3f %6zu %10.1f %10.1f %8.3f %6zu %10.1f\n",
+           set == KEYS_NUMERIC ? "numeric" : "random", hash_type == H_ADLER ? "adler" : "wy",
+           probeName(probing), distinct, HT->size, key_collisions, home_collisions, avg, max,
+           t_insert*1e9/n, t_lookup*1e9/distinct, avg_churn, max_churn, t_churn*1e9/distinct);
+
+    free(home);
+    free(hashes);
+    free(recs);
+    free(keys);
+    freeHTable_OA(HT);
+}
+
+int main(int argc, char *argv[]){
+    size_t n = 100000;
+    if(argc > 1)
+        n = strtoull(argv[1], NULL, 10);
+    printf("%-8s %-6s %-3s %8s %8s %10s %10s %8s %6s %10s %10s %8s %6s %10s\n",
+           "keys", "hash", "prb", "distinct", "size", "key_coll", "home_coll", "avg_prb", "max", "ns/insert", "ns/lookup",
+           "avg_chrn", "max", "ns/lookup");
+    int sets[] = {KEYS_NUMERIC, KEYS_RANDOM};
+    int hashes[] = {H_ADLER, H_WY};
+    //Lista de sondeos a medir (mismos nombres que la opción -p del intérprete)
+    char list[64] = "lp,qp,dh,rh,sw";
+    if(argc > 2)
+        snprintf(list, sizeof(list), "%s", argv[2]);
+    int pow2 = (argc > 3 && strcmp(argv[3], "pow2") == 0) ? YES : NO;
+    int probings[8], count = 0;
+    for(char *name = strtok(list, ","); name != NULL && count < 8; name = strtok(NULL, ",")){
+        probings[count] = probingMode(name);
+        if(probings[count] == 0){
+            fprintf(stderr, "Sondeo no valido: %s\n", name);
+            return 1;
+        }
+        count++;
+    }
+    for(int s=0; s<2; s++)
+        for(int h=0; h<2; h++)
+            for(int p=0; p<count; p++)
+                run(sets[s], hashes[h], probings[p], pow2, n);
+    return 0;
+}
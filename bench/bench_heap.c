@@ -0,0 +1,84 @@
+//QUASH - Benchmark del heap: costo de insert y deleteMin según la aridad (HEAP_ARITY) elegida al compilar
+//Compilación (una vez por aridad):
+//  gcc -O2 -pthread -DHEAP_ARITY=2 -o bench_heap2 bench/bench_heap.c
+//  gcc -O2 -pthread -DHEAP_ARITY=4 -o bench_heap4 bench/bench_heap.c
+//  gcc -O2 -pthread -DHEAP_ARITY=8 -o bench_heap8 bench/bench_heap.c
+//Uso: ./bench_heap4 [n]      (n = cantidad de llaves distintas, por defecto 1000000)
+#define QUASH_NO_MAIN
+#include "../Quash.c"
+
+/*Generador pseudoaleatorio (xorshift64) para que las corridas sean reproducibles*/
+static uint64_t rng_state = 0x9e3779b97f4a7c15ull;
+static inline uint64_t rng(){
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static double seconds(){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec*1e-9;
+}
+
+/*Llena "rec" con una llave al azar (en modo de cadenas, sus dígitos decimales)*/
+static void makeKey(int numeric, int64_t *num, char *buffer, record *rec){
+    *num = (int64_t)(rng() % 1000000000000ull);
+    if(numeric){
+        rec->bytes = num;
+        rec->len = sizeof(int64_t);
+    }
+    else{
+        rec->len = sprintf(buffer, "%" PRId64, *num);
+        rec->bytes = buffer;
+    }
+}
+
+static void run(int numeric, size_t n){
+    //En modo OUT_QUIET las operaciones sólo cuentan sus resultados (no se mide el costo de imprimir)
+    HTconfig cfg = {H_WY, numeric, NO, DH, OUT_QUIET, NO, 0, 0, 0, HUGE_THP, ENGINE_HEAP};
+    HTable_OA *HT = newHTable_OA(cfg);
+    int64_t num;
+    char buffer[32];
+    record rec;
+
+    //1) Se insertan n llaves
+    rng_state = 0x9e3779b97f4a7c15ull;
+    double t0 = seconds();
+    for(size_t i=0; i<n; i++){
+        makeKey(numeric, &num, buffer, &rec);
+        InsertElement(&HT, &rec);
+    }
+    double t_insert = seconds() - t0;
+
+    //2) Tráfico estable: por cada insert, un deleteMin (el heap conserva su tamaño)
+    t0 = seconds();
+    for(size_t i=0; i<n; i++){
+        makeKey(numeric, &num, buffer, &rec);
+        InsertElement(&HT, &rec);
+        deleteMin(&HT);
+    }
+    double t_steady = seconds() - t0;
+
+    //3) Se vacía el heap con deleteMin
+    size_t remaining = HT->h->index;
+    t0 = seconds();
+    while(HT->h->index > 0)
+        deleteMin(&HT);
+    double t_drain = seconds() - t0;
+
+    printf("%-7s %5d %9zu %12.1f %12.1f %12.1f\n", numeric ? "numeric" : "string", HEAP_ARITY, n,
+           t_insert*1e9/n, t_steady*1e9/n, t_drain*1e9/remaining);
+    freeHTable_OA(HT);
+}
+
+int main(int argc, char *argv[]){
+    size_t n = 1000000;
+    if(argc > 1)
+        n = strtoull(argv[1], NULL, 10);
+    printf("%-7s %5s %9s %12s %12s %12s\n", "keys", "arity", "n", "ns/insert", "ns/ins+dmin", "ns/deleteMin");
+    run(YES, n);
+    run(NO, n);
+    return 0;
+}
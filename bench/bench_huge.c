@@ -0,0 +1,113 @@
+//QUASH - Benchmark de páginas grandes: inserts, búsquedas al azar y deleteMin con la tabla y el heap en páginas
+//... normales (off), transparentes (thp) o reservadas (explicit), para n del orden de 10^8 llaves
+//NOTA: Las llaves son enteros (modo numérico) para que sólo cuenten los accesos a la tabla y al heap. Por cada modo se
+//... reporta cuánta memoria quedó realmente en páginas grandes (AnonHugePages y Hugetlb de /proc/self/smaps_rollup);
+//... sin páginas reservadas en /proc/sys/vm/nr_hugepages, "explicit" usa las transparentes
+//Compilación: gcc -O2 -pthread -DHASH_BITS=64 -o bench_huge bench/bench_huge.c
+//Uso: ./bench_huge [n] [búsquedas] [pow2]      (n = cantidad de llaves, por defecto 100000000; búsquedas y deleteMin
+//... medidos, por defecto 10000000; con "pow2" las tablas son potencias de dos)
+#define QUASH_NO_MAIN
+#include "../Quash.c"
+
+/*Llave número "i" (mezclada para que las casillas queden al azar; siempre la misma para el mismo i)*/
+static inline int64_t keyAt(uint64_t i){
+    return (int64_t)(mix64(i + 0x9e3779b97f4a7c15ull) >> 2);
+}
+
+/*Generador pseudoaleatorio (xorshift64) para elegir qué llaves se buscan*/
+static uint64_t rng_state = 0x9e3779b97f4a7c15ull;
+static inline uint64_t rng(){
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static double seconds(){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec*1e-9;
+}
+
+/*KB de un campo de /proc/self/smaps_rollup (0 si no existe)*/
+static long smapsField(const char *field){
+    FILE *f = fopen("/proc/self/smaps_rollup", "r");
+    char line[256];
+    long kb = 0;
+    size_t len = strlen(field);
+    if(f == NULL)
+        return 0;
+    while(fgets(line, sizeof(line), f) != NULL)
+        if(strncmp(line, field, len) == 0 && line[len] == ':')
+            kb += strtol(line + len + 1, NULL, 10);
+    fclose(f);
+    return kb;
+}
+
+static const char* pagesName(int huge){
+    return huge == HUGE_OFF ? "off" : huge == HUGE_EXPLICIT ? "explicit" : "thp";
+}
+
+static void run(int huge, int pow2, size_t n, size_t lookups){
+    //La tabla se reserva de una vez con el tamaño final (no se mide el remodelado, sólo el acceso a memoria)
+    HTconfig cfg = {H_WY, YES, NO, DH, OUT_QUIET, pow2, 0, 0, 0, huge, ENGINE_HEAP};
+    size_t index = 0;
+    while(index + 1 < tableCount(&cfg) && loadLimit(&cfg, tableSize(&cfg, index)) <= n)
+        index++;
+    HTable_OA *HT = newHTableCap_OA(index, cfg);
+    int64_t num;
+    record rec = {&num, sizeof(int64_t)};
+
+    //1) Se insertan n llaves
+    double t0 = seconds();
+    for(size_t i=0; i<n; i++){
+        num = keyAt(i);
+        InsertElement(&HT, &rec);
+    }
+    double t_insert = seconds() - t0;
+    long anon_huge = smapsField("AnonHugePages");
+    long tlb_huge = smapsField("Private_Hugetlb") + smapsField("Shared_Hugetlb");
+
+    //2) Búsquedas de llaves al azar (cada una cae en una página distinta de la tabla)
+    rng_state = 0x9e3779b97f4a7c15ull;
+    t0 = seconds();
+    for(size_t i=0; i<lookups; i++){
+        num = keyAt(rng() % n);
+        if(HTfindRecord_OA(&HT, &rec, DH) == NULL){
+            fprintf(stderr, "llave %" PRId64 " no encontrada\n", num);
+            exit(1);
+        }
+    }
+    double t_lookup = seconds() - t0;
+
+    //3) deleteMin (cada intercambio del heap actualiza una casilla de la tabla)
+    size_t drains = lookups < n ? lookups : n;
+    t0 = seconds();
+    for(size_t i=0; i<drains; i++)
+        deleteMin(&HT);
+    double t_drain = seconds() - t0;
+
+    printf("%-8s %5d %4s %11zu %11zu %10.1f %10.1f %10.1f %12ld %12ld\n", pagesName(huge), HASH_BITS,
+           pow2 ? "yes" : "no", n, HT->size, t_insert*1e9/n, t_lookup*1e9/lookups, t_drain*1e9/drains, anon_huge,
+           tlb_huge);
+    freeHTable_OA(HT);
+}
+
+int main(int argc, char *argv[]){
+    size_t n = 100000000, lookups = 10000000;
+    if(argc > 1)
+        n = strtoull(argv[1], NULL, 10);
+    if(argc > 2)
+        lookups = strtoull(argv[2], NULL, 10);
+    int pow2 = (argc > 3 && strcmp(argv[3], "pow2") == 0) ? YES : NO;
+    if(n == 0 || lookups == 0){
+        fprintf(stderr, "Uso: %s [n] [busquedas] [pow2]\n", argv[0]);
+        return 1;
+    }
+    printf("%-8s %5s %4s %11s %11s %10s %10s %10s %12s %12s\n", "pages", "bits", "pow2", "n", "size", "ns/insert",
+           "ns/lookup", "ns/dmin", "anon_huge_kb", "hugetlb_kb");
+    int modes[] = {HUGE_OFF, HUGE_THP, HUGE_EXPLICIT};
+    for(int m=0; m<3; m++)
+        run(modes[m], pow2, n, lookups);
+    return 0;
+}
@@ -0,0 +1,96 @@
+//QUASH - Benchmark de la carga masiva: n llaves con InsertElement una por una contra bulkLoad (tabla reservada una
+//... sola vez, repetidos eliminados en paralelo y heap armado con Floyd)
+//Compilación: gcc -O2 -pthread -o bench_load bench/bench_load.c
+//Uso: ./bench_load [n] [sondeo]      (n = cantidad de llaves, por defecto 1000000; sondeo como en -p, por defecto dh)
+#define QUASH_NO_MAIN
+#include "../Quash.c"
+
+/*Generador pseudoaleatorio (xorshift64) para que las corridas sean reproducibles*/
+static uint64_t rng_state = 0x9e3779b97f4a7c15ull;
+static inline uint64_t rng(){
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static double seconds(){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec*1e-9;
+}
+
+/*Verifica que el heap cumpla la propiedad de orden (cada nodo no es menor que su padre)*/
+static void checkHeap(HTable_OA *HT){
+    heap *h = HT->h;
+    for(size_t i=2; i<=h->index; i++){
+        if(heapcmp(h, &h->array[i], &h->array[parent(i)]) == -1){
+            fprintf(stderr, "heap desordenado en %zu\n", i);
+            exit(1);
+        }
+    }
+}
+
+static void run(int numeric, int probing, size_t n){
+    //Llaves con repetidos: se toman de un rango de n/2 valores
+    int64_t *nums = malloc(sizeof(int64_t)*n);
+    char (*text)[24] = malloc(24*n);
+    record *recs = malloc(sizeof(record)*n);
+    rng_state = 0x9e3779b97f4a7c15ull;
+    for(size_t i=0; i<n; i++){
+        nums[i] = (int64_t)(rng() % (n/2 + 1));
+        if(numeric){
+            recs[i].bytes = &nums[i];
+            recs[i].len = sizeof(int64_t);
+        }
+        else{
+            recs[i].len = sprintf(text[i], "%" PRId64, nums[i]);
+            recs[i].bytes = text[i];
+        }
+    }
+    //En modo OUT_QUIET las operaciones sólo cuentan sus resultados (no se mide el costo de imprimir)
+    HTconfig cfg = {H_WY, numeric, NO, probing, OUT_QUIET, NO, 0, 0, 0, HUGE_THP, ENGINE_HEAP};
+
+    //1) Una por una
+    HTable_OA *HT = newHTable_OA(cfg);
+    double t0 = seconds();
+    for(size_t i=0; i<n; i++)
+        InsertElement(&HT, &recs[i]);
+    double t_single = seconds() - t0;
+    size_t distinct = HT->occupied_elements;
+    freeHTable_OA(HT);
+
+    //2) Carga masiva
+    HT = newHTable_OA(cfg);
+    t0 = seconds();
+    size_t added = bulkLoad(&HT, recs, n);
+    double t_bulk = seconds() - t0;
+    if(added != distinct){
+        fprintf(stderr, "distintos: %zu (bulkLoad) contra %zu (InsertElement)\n", added, distinct);
+        exit(1);
+    }
+    checkHeap(HT);
+    freeHTable_OA(HT);
+
+    printf("%-7s %-3s %9zu %9zu %12.1f %12.1f %8.2f\n", numeric ? "numeric" : "string",
+           probing == LP ? "lp" : probing == QP ? "qp" : probing == RH ? "rh" : probing == SW ? "sw" : "dh",
+           n, distinct, t_single*1e9/n, t_bulk*1e9/n, t_single/t_bulk);
+    free(recs);
+    free(text);
+    free(nums);
+}
+
+int main(int argc, char *argv[]){
+    size_t n = 1000000;
+    int probing = DH;
+    if(argc > 1)
+        n = strtoull(argv[1], NULL, 10);
+    if(argc > 2 && (probing = probingMode(argv[2])) == 0){
+        fprintf(stderr, "Sondeo no valido: %s\n", argv[2]);
+        return 1;
+    }
+    printf("%-7s %-3s %9s %9s %12s %12s %8s\n", "keys", "prb", "n", "distinct", "ns/insert", "ns/bulk", "speedup");
+    run(YES, probing, n);
+    run(NO, probing, n);
+    return 0;
+}
@@ -0,0 +1,373 @@
+//QUASH - Benchmark por carga de trabajo: mezcla configurable de insert, delete, lookup y deleteMin con llaves de
+//... distribución uniforme o Zipf; reporta por operación el rendimiento y los percentiles de latencia (p50, p99 y
+//... p999), además del pico de memoria (RSS). La salida puede ser una tabla, CSV o JSON para comparar variantes (familia
+//... hash, sondeo, aridad del heap) y detectar regresiones
+//Compilación: gcc -O2 -pthread -DHEAP_ARITY=2 -DHASH_BITS=32 -o bench_ops bench/bench_ops.c -lm
+//Uso: ./bench_ops [opciones]
+//  -o <ops>        operaciones medidas (por defecto 1000000)
+//  -w <ops>        inserts previos, sin medir (por defecto 100000)
+//  -m <i,d,l,m>    pesos de insert, delete, lookup y deleteMin (por defecto 50,20,25,5)
+//  -u <llaves>     universo de rangos de la distribución (por defecto 1000000)
+//  -d <dist>       uniform o zipf (por defecto uniform)
+//  -z <s>          exponente de Zipf (por defecto 0.99)
+//  -r <fracción>   fracción de inserts que repiten una llave ya insertada (por defecto 0.2)
+//  -H <hash>       adler o wy (por defecto wy)
+//  -p <sondeo>     lp, qp, dh, rh o sw (por defecto dh)
+//  -n, -i, -2      modo numérico, remodelado incremental y tamaños potencia de dos (como en el intérprete)
+//  -L <max,min,h>  política de carga (como en el intérprete)
+//  -P <páginas>    off, thp o explicit: páginas de la tabla y del heap (por defecto thp, como el -H del intérprete)
+//  -e <motor>      heap o radix (por defecto heap; radix requiere -n)
+//  -f <formato>    text, csv o json (por defecto text)
+//  -s <semilla>    semilla del generador (por defecto 1)
+//  -l <etiqueta>   nombre de la corrida en la salida (por defecto "quash")
+//NOTA: Cada operación se mide con clock_gettime (unos 20 ns de costo propio, incluidos en las cifras); el rendimiento
+//... de cada tipo es cuántas operaciones de ese tipo caben en un segundo según su tiempo total medido
+#define QUASH_NO_MAIN
+#include "../Quash.c"
+#include <math.h>
+#include <sys/resource.h>
+
+#define OP_TYPES 4
+static const char *OP_NAMES[OP_TYPES] = {"insert", "delete", "lookup", "deleteMin"};
+
+/*Generador pseudoaleatorio (xorshift64) para que las corridas sean reproducibles*/
+static uint64_t rng_state = 0x9e3779b97f4a7c15ull;
+static inline uint64_t rng(){
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+/*Número uniforme en [0, 1)*/
+static inline double uniform01(){
+    return (rng() >> 11) * (1.0/9007199254740992.0);
+}
+
+static inline uint64_t nanoseconds(){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec*1000000000ull + t.tv_nsec;
+}
+
+/*Distribución Zipf en 1..n por rechazo-inversión (Hörmann y Derflinger): tiempo constante y sin tablas*/
+typedef struct {
+    double s, n;
+    double h_x1, h_n, s_const;
+} zipf_gen;
+
+static double zipfHelper1(double x){
+    return fabs(x) > 1e-8 ? log1p(x)/x : 1 - x*(0.5 - x*(1.0/3 - 0.25*x));
+}
+static double zipfHelper2(double x){
+    return fabs(x) > 1e-8 ? expm1(x)/x : 1 + x*0.5*(1 + x/3*(1 + 0.25*x));
+}
+static double zipfH(zipf_gen *Z, double x){
+    return exp(-Z->s*log(x));
+}
+static double zipfHIntegral(zipf_gen *Z, double x){
+    double lx = log(x);
+    return zipfHelper2((1 - Z->s)*lx)*lx;
+}
+static double zipfHIntegralInverse(zipf_gen *Z, double x){
+    double t = x*(1 - Z->s);
+    if(t < -1)
+        t = -1;
+    return exp(zipfHelper1(t)*x);
+}
+
+static void initZipf(zipf_gen *Z, double s, size_t n){
+    Z->s = s;
+    Z->n = (double)n;
+    Z->h_x1 = zipfHIntegral(Z, 1.5) - 1;
+    Z->h_n = zipfHIntegral(Z, Z->n + 0.5);
+    Z->s_const = 2 - zipfHIntegralInverse(Z, zipfHIntegral(Z, 2.5) - zipfH(Z, 2));
+}
+
+static size_t zipfSample(zipf_gen *Z){
+    for(;;){
+        double u = Z->h_n + uniform01()*(Z->h_x1 - Z->h_n);
+        double x = zipfHIntegralInverse(Z, u);
+        double k = floor(x + 0.5);
+        if(k < 1)
+            k = 1;
+        else if(k > Z->n)
+            k = Z->n;
+        if(k - x <= Z->s_const || u >= zipfHIntegral(Z, k + 0.5) - zipfH(Z, k))
+            return (size_t)k;
+    }
+}
+
+/*Opciones de la corrida*/
+typedef struct {
+    size_t ops, warmup, universe;
+    double weight[OP_TYPES];
+    int zipf;
+    double s, dup;
+    uint64_t seed;
+    const char *format, *label;
+    HTconfig cfg;
+} workload;
+
+/*La i-ésima llave nueva (splitmix64 del contador: distinta para cada i salvo colisiones rarísimas)*/
+static int64_t freshKey(uint64_t i){
+    uint64_t z = i + 0x9e3779b97f4a7c15ull;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    z ^= z >> 31;
+    return (int64_t)(z % 1000000000000ull);
+}
+
+/*Índice (entre las "fresh" llaves ya generadas) de una llave existente según la distribución elegida. El rango 1 de
+ * Zipf es la llave más caliente; los rangos mayores que las llaves generadas se reparten con módulo*/
+static uint64_t pickKey(workload *W, zipf_gen *Z, uint64_t fresh){
+    uint64_t rank = W->zipf ? zipfSample(Z) - 1 : rng() % W->universe;
+    return rank % fresh;
+}
+
+/*Llena "rec" con la llave (en modo de cadenas, sus dígitos decimales)*/
+static void makeRecord(int numeric, int64_t key, int64_t *num, char *buffer, record *rec){
+    *num = key;
+    if(numeric){
+        rec->bytes = num;
+        rec->len = sizeof(int64_t);
+    }
+    else{
+        rec->len = sprintf(buffer, "%" PRId64, key);
+        rec->bytes = buffer;
+    }
+}
+
+static int cmpLatency(const void *a, const void *b){
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+/*Percentil "p" (entre 0 y 1) de un arreglo ordenado*/
+static uint32_t percentile(uint32_t *lat, size_t n, double p){
+    if(n == 0)
+        return 0;
+    size_t at = (size_t)ceil(p*n);
+    return lat[at > 0 ? at - 1 : 0];
+}
+
+static const char* probeName(int probing){
+    switch(probing){
+    case LP: return "lp";
+    case QP: return "qp";
+    case RH: return "rh";
+    case SW: return "sw";
+    default: return "dh";
+    }
+}
+
+/*Resultados de un tipo de operación*/
+typedef struct {
+    size_t count;
+    double seconds;
+    uint32_t p50, p99, p999, max;
+} op_stats;
+
+static const char* pagesName(int huge){
+    return huge == HUGE_OFF ? "off" : huge == HUGE_EXPLICIT ? "explicit" : "thp";
+}
+
+static void report(workload *W, op_stats *st, size_t distinct, long rss_kb){
+    const char *hash = W->cfg.hash_type == H_ADLER ? "adler" : "wy";
+    const char *pages = pagesName(W->cfg.huge);
+    const char *engine = W->cfg.engine == ENGINE_RADIX ? "radix" : "heap";
+    const char *dist = W->zipf ? "zipf" : "uniform";
+    if(strcmp(W->format, "csv") == 0){
+        printf("label,hash,hash_bits,probing,arity,engine,numeric,incremental,pow2,pages,dist,zipf_s,dup,op,count,"
+               "ops_per_s,p50_ns,p99_ns,p999_ns,max_ns,distinct,peak_rss_kb\n");
+        for(int t=0; t<OP_TYPES; t++)
+            printf("%s,%s,%d,%s,%d,%s,%d,%d,%d,%s,%s,%.3f,%.3f,%s,%zu,%.0f,%u,%u,%u,%u,%zu,%ld\n", W->label, hash,
+                   HASH_BITS, probeName(W->cfg.probing), HEAP_ARITY, engine, W->cfg.numeric, W->cfg.incremental,
+                   W->cfg.pow2, pages, dist, W->s,
+                   W->dup, OP_NAMES[t], st[t].count, st[t].seconds > 0 ? st[t].count/st[t].seconds : 0, st[t].p50,
+                   st[t].p99, st[t].p999, st[t].max, distinct, rss_kb);
+        return;
+    }
+    if(strcmp(W->format, "json") == 0){
+        printf("{\"label\": \"%s\", \"hash\": \"%s\", \"hash_bits\": %d, \"probing\": \"%s\", \"arity\": %d, "
+               "\"engine\": \"%s\", \"numeric\": %d, \"incremental\": %d, \"pow2\": %d, \"pages\": \"%s\", "
+               "\"dist\": \"%s\", \"zipf_s\": %.3f, \"dup\": %.3f, \"ops\": %zu, \"warmup\": %zu, \"distinct\": %zu, "
+               "\"peak_rss_kb\": %ld, \"results\": [", W->label, hash, HASH_BITS, probeName(W->cfg.probing), HEAP_ARITY,
+               engine, W->cfg.numeric, W->cfg.incremental, W->cfg.pow2, pages, dist, W->s, W->dup, W->ops, W->warmup,
+               distinct, rss_kb);
+        for(int t=0; t<OP_TYPES; t++)
+            printf("%s{\"op\": \"%s\", \"count\": %zu, \"ops_per_s\": %.0f, \"p50_ns\": %u, \"p99_ns\": %u, "
+                   "\"p999_ns\": %u, \"max_ns\": %u}", t ? ", " : "", OP_NAMES[t], st[t].count,
+                   st[t].seconds > 0 ? st[t].count/st[t].seconds : 0, st[t].p50, st[t].p99, st[t].p999, st[t].max);
+        printf("]}\n");
+        return;
+    }
+    printf("%s: hash %s (%d bits), sondeo %s, aridad %d, motor %s, %s, %s%spáginas %s, %s (s = %.2f), dup = %.2f, "
+           "distintas = %zu, RSS pico = %ld KB\n", W->label, hash, HASH_BITS, probeName(W->cfg.probing), HEAP_ARITY,
+           engine, W->cfg.numeric ? "numeric" : "string", W->cfg.incremental ? "incremental, " : "",
+           W->cfg.pow2 ? "pow2, " : "", pages, dist, W->s, W->dup, distinct, rss_kb);
+    printf("%-10s %9s %12s %9s %9s %9s %9s\n", "op", "count", "Mops/s", "p50_ns", "p99_ns", "p999_ns", "max_ns");
+    for(int t=0; t<OP_TYPES; t++)
+        printf("%-10s %9zu %12.2f %9u %9u %9u %9u\n", OP_NAMES[t], st[t].count,
+               st[t].seconds > 0 ? st[t].count/st[t].seconds/1e6 : 0, st[t].p50, st[t].p99, st[t].p999, st[t].max);
+}
+
+static void run(workload *W){
+    HTable_OA *HT = newHTable_OA(W->cfg);
+    zipf_gen Z;
+    initZipf(&Z, W->s, W->universe);
+    rng_state = 0x9e3779b97f4a7c15ull ^ (W->seed*0xbf58476d1ce4e5b9ull);
+    if(rng_state == 0)
+        rng_state = 1;
+    int64_t num;
+    char buffer[32];
+    record rec;
+    uint64_t fresh = 0;
+
+    //Inserts previos (no se miden)
+    for(size_t i=0; i<W->warmup; i++){
+        makeRecord(W->cfg.numeric, freshKey(fresh++), &num, buffer, &rec);
+        InsertElement(&HT, &rec);
+    }
+
+    //Se eligen todas las operaciones antes de medir (el costo de generarlas no entra en las latencias)
+    uint8_t *type = malloc(W->ops);
+    int64_t *keys = malloc(sizeof(int64_t)*W->ops);
+    uint32_t *lat = malloc(sizeof(uint32_t)*W->ops);
+    if(type == NULL || keys == NULL || lat == NULL){
+        fprintf(stderr, "Error en malloc!\n");
+        exit(1);
+    }
+    double total = 0;
+    for(int t=0; t<OP_TYPES; t++)
+        total += W->weight[t];
+    for(size_t i=0; i<W->ops; i++){
+        double u = uniform01()*total;
+        int t = 0;
+        while(t < OP_TYPES - 1 && u >= W->weight[t]){
+            u -= W->weight[t];
+            t++;
+        }
+        type[i] = t;
+        //Un insert repite una llave existente con probabilidad "dup"; si no, usa una nueva
+        if(t == 0 && (fresh == 0 || uniform01() >= W->dup))
+            keys[i] = freshKey(fresh++);
+        else
+            keys[i] = fresh ? freshKey(pickKey(W, &Z, fresh)) : freshKey(0);
+    }
+
+    for(size_t i=0; i<W->ops; i++){
+        if(type[i] != 3)
+            makeRecord(W->cfg.numeric, keys[i], &num, buffer, &rec);
+        uint64_t t0 = nanoseconds();
+        switch(type[i]){
+        case 0: InsertElement(&HT, &rec); break;
+        case 1: DeleteElement(&HT, &rec); break;
+        case 2: LookUpElement(&HT, &rec); break;
+        default: deleteMin(&HT); break;
+        }
+        uint64_t elapsed = nanoseconds() - t0;
+        lat[i] = elapsed > UINT32_MAX ? UINT32_MAX : (uint32_t)elapsed;
+    }
+    size_t distinct = HT->occupied_elements;
+
+    //Latencias de cada tipo: se agrupan, se ordenan y se toman los percentiles
+    op_stats st[OP_TYPES];
+    uint32_t *group = malloc(sizeof(uint32_t)*W->ops);
+    for(int t=0; t<OP_TYPES; t++){
+        size_t n = 0;
+        double sum = 0;
+        for(size_t i=0; i<W->ops; i++){
+            if(type[i] == t){
+                group[n++] = lat[i];
+                sum += lat[i];
+            }
+        }
+        qsort(group, n, sizeof(uint32_t), cmpLatency);
+        st[t].count = n;
+        st[t].seconds = sum*1e-9;
+        st[t].p50 = percentile(group, n, 0.5);
+        st[t].p99 = percentile(group, n, 0.99);
+        st[t].p999 = percentile(group, n, 0.999);
+        st[t].max = n ? group[n-1] : 0;
+    }
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    report(W, st, distinct, usage.ru_maxrss);
+
+    free(group);
+    free(lat);
+    free(keys);
+    free(type);
+    freeHTable_OA(HT);
+}
+
+int main(int argc, char *argv[]){
+    workload W = {1000000, 100000, 1000000, {50, 20, 25, 5}, NO, 0.99, 0.2, 1, "text", "quash",
+                  {H_WY, NO, NO, DH, OUT_QUIET, NO, 0, 0, 0, HUGE_THP, ENGINE_HEAP}};
+    for(int i=1; i<argc; i++){
+        const char *arg = (i+1 < argc) ? argv[i+1] : NULL;
+        if(strcmp("-n", argv[i])==0)
+            W.cfg.numeric = YES;
+        else if(strcmp("-i", argv[i])==0)
+            W.cfg.incremental = YES;
+        else if(strcmp("-2", argv[i])==0)
+            W.cfg.pow2 = YES;
+        else if(arg == NULL){
+            fprintf(stderr, "Falta el valor de %s\n", argv[i]);
+            return 1;
+        }
+        else{
+            i++;
+            if(strcmp("-o", argv[i-1])==0)
+                W.ops = strtoull(arg, NULL, 10);
+            else if(strcmp("-w", argv[i-1])==0)
+                W.warmup = strtoull(arg, NULL, 10);
+            else if(strcmp("-u", argv[i-1])==0)
+                W.universe = strtoull(arg, NULL, 10);
+            else if(strcmp("-m", argv[i-1])==0)
+                sscanf(arg, "%lf,%lf,%lf,%lf", &W.weight[0], &W.weight[1], &W.weight[2], &W.weight[3]);
+            else if(strcmp("-d", argv[i-1])==0)
+                W.zipf = strcmp(arg, "zipf") == 0;
+            else if(strcmp("-z", argv[i-1])==0)
+                W.s = strtod(arg, NULL);
+            else if(strcmp("-r", argv[i-1])==0)
+                W.dup = strtod(arg, NULL);
+            else if(strcmp("-H", argv[i-1])==0)
+                W.cfg.hash_type = strcmp(arg, "adler") == 0 ? H_ADLER : H_WY;
+            else if(strcmp("-p", argv[i-1])==0){
+                W.cfg.probing = probingMode(arg);
+                if(W.cfg.probing == 0){
+                    fprintf(stderr, "Sondeo no valido: %s\n", arg);
+                    return 1;
+                }
+            }
+            else if(strcmp("-L", argv[i-1])==0)
+                sscanf(arg, "%d,%d,%d", &W.cfg.max_load, &W.cfg.min_load, &W.cfg.hysteresis);
+            else if(strcmp("-P", argv[i-1])==0)
+                W.cfg.huge = strcmp(arg, "off") == 0 ? HUGE_OFF : strcmp(arg, "explicit") == 0 ? HUGE_EXPLICIT : HUGE_THP;
+            else if(strcmp("-e", argv[i-1])==0)
+                W.cfg.engine = strcmp(arg, "radix") == 0 ? ENGINE_RADIX : ENGINE_HEAP;
+            else if(strcmp("-f", argv[i-1])==0)
+                W.format = arg;
+            else if(strcmp("-s", argv[i-1])==0)
+                W.seed = strtoull(arg, NULL, 10);
+            else if(strcmp("-l", argv[i-1])==0)
+                W.label = arg;
+            else{
+                fprintf(stderr, "Opcion no valida: %s\n", argv[i-1]);
+                return 1;
+            }
+        }
+    }
+    if(W.universe == 0 || W.ops == 0){
+        fprintf(stderr, "Las operaciones y el universo deben ser mayores que 0\n");
+        return 1;
+    }
+    if(W.cfg.engine == ENGINE_RADIX && !W.cfg.numeric){
+        fprintf(stderr, "El motor radix requiere el modo numerico (-n)\n");
+        return 1;
+    }
+    run(&W);
+    return 0;
+}
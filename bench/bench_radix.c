@@ -0,0 +1,99 @@
+//QUASH - Benchmark de motores de prioridad: heap (comparaciones) contra radix heap en la carga de un simulador de
+//... eventos discretos. Se cargan n eventos con tiempos al azar y luego, en cada paso, se saca el evento más próximo
+//... (popK de 1) y se agenda uno nuevo en ese tiempo más un retraso al azar: los mínimos extraídos nunca decrecen
+//NOTA: Las llaves son enteros (el motor radix sólo existe en modo numérico). Al final se verifica que los eventos
+//... hayan salido en orden y se reporta cuántos nodos redistribuyó el radix y si tuvo que reconstruir las cubetas
+//Compilación: gcc -O2 -pthread -o bench_radix bench/bench_radix.c
+//Uso: ./bench_radix [n] [eventos] [retraso]      (n = eventos pendientes, por defecto 1000000; eventos simulados, por
+//... defecto 5000000; retraso máximo de cada evento nuevo, por defecto 1000000)
+#define QUASH_NO_MAIN
+#include "../Quash.c"
+
+/*Generador pseudoaleatorio (xorshift64) para que las corridas sean reproducibles*/
+static uint64_t rng_state = 0x9e3779b97f4a7c15ull;
+static inline uint64_t rng(){
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static double seconds(){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec*1e-9;
+}
+
+/*Saca el evento más próximo y regresa su tiempo*/
+static int64_t nextEvent(HTable_OA **HT){
+    pop_item item;
+    popK(HT, 1, &item);
+    shrinkHTable_OA(HT, (*HT)->cfg.probing);
+    return item.node.num;
+}
+
+static void run(int engine, size_t n, size_t events, uint64_t delay){
+    HTconfig cfg = {H_WY, YES, NO, DH, OUT_QUIET, NO, 0, 0, 0, HUGE_THP, engine};
+    HTable_OA *HT = newHTable_OA(cfg);
+    int64_t num;
+    record rec = {&num, sizeof(int64_t)};
+    int ordered = YES;
+
+    //1) Eventos iniciales, con tiempos al azar en [0, retraso)
+    rng_state = 0x9e3779b97f4a7c15ull;
+    double t0 = seconds();
+    for(size_t i=0; i<n; i++){
+        num = (int64_t)(rng() % delay);
+        InsertElement(&HT, &rec);
+    }
+    double t_insert = seconds() - t0;
+
+    //2) Simulación: cada evento que sale agenda otro más adelante (el pendiente más próximo nunca retrocede)
+    int64_t now = 0;
+    t0 = seconds();
+    for(size_t i=0; i<events; i++){
+        int64_t t = nextEvent(&HT);
+        if(t < now)
+            ordered = NO;
+        now = t;
+        num = now + 1 + (int64_t)(rng() % delay);
+        InsertElement(&HT, &rec);
+    }
+    double t_sim = seconds() - t0;
+
+    //3) Se vacía la agenda
+    size_t remaining = HT->h->index;
+    t0 = seconds();
+    while(HT->h->index > 0){
+        int64_t t = nextEvent(&HT);
+        if(t < now)
+            ordered = NO;
+        now = t;
+    }
+    double t_drain = seconds() - t0;
+
+    printf("%-6s %9zu %10zu %12.1f %12.1f %12.1f %12zu %9zu %8s\n", engine == ENGINE_RADIX ? "radix" : "heap", n,
+           events, t_insert*1e9/n, t_sim*1e9/events, remaining ? t_drain*1e9/remaining : 0.0, HT->stats.radix_moves,
+           HT->stats.radix_rebuilds, ordered ? "yes" : "NO");
+    freeHTable_OA(HT);
+}
+
+int main(int argc, char *argv[]){
+    size_t n = 1000000, events = 5000000;
+    uint64_t delay = 1000000;
+    if(argc > 1)
+        n = strtoull(argv[1], NULL, 10);
+    if(argc > 2)
+        events = strtoull(argv[2], NULL, 10);
+    if(argc > 3)
+        delay = strtoull(argv[3], NULL, 10);
+    if(n == 0 || delay == 0){
+        fprintf(stderr, "Uso: %s [n] [eventos] [retraso]\n", argv[0]);
+        return 1;
+    }
+    printf("%-6s %9s %10s %12s %12s %12s %12s %9s %8s\n", "engine", "n", "events", "ns/insert", "ns/event",
+           "ns/drain", "radix_moves", "rebuilds", "ordered");
+    run(ENGINE_HEAP, n, events, delay);
+    run(ENGINE_RADIX, n, events, delay);
+    return 0;
+}
@@ -0,0 +1,183 @@
+//QUASH - Benchmark del quash por shards: rendimiento de insert y lookup con varios hilos según la cantidad de shards
+//... (1 shard = un solo candado para todos). Luego los hilos vacían el quash con el deleteMin global (se verifica que
+//... cada hilo reciba sus llaves en orden y que salgan todas) y, después de llenarlo otra vez, con el deleteMin
+//... relajado (MultiQueue). Al final se mide con un solo hilo el error de rango del deleteMin relajado
+//Compilación: gcc -O2 -pthread -o bench_shard bench/bench_shard.c
+//Uso: ./bench_shard [n] [hilos] [shards]      (n = operaciones por hilo, por defecto 200000; hilos, por defecto los
+//... núcleos; shards separados por comas, por defecto "1,hilos,4*hilos")
+#define QUASH_NO_MAIN
+#include "../Quash.c"
+
+/*Generador pseudoaleatorio (xorshift64); cada hilo tiene su propio estado*/
+static inline uint64_t rng(uint64_t *state){
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static double seconds(){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec*1e-9;
+}
+
+typedef struct {
+    sharded_quash *Q;
+    size_t id, n;
+    int phase;                  //0 = insert, 1 = lookup, 2 = deleteMin, 3 = deleteMin relajado
+    size_t popped;              //Unidades que sacó con deleteMin
+    int ordered;                //NO si recibió una llave menor que la anterior
+} worker;
+
+/*Siguiente llave de un hilo (enteros de 64 bits; algunas se repiten y quedan con multiplicidad)*/
+static int64_t keyOf(uint64_t *state){
+    return (int64_t)(rng(state) % 4000000000ull) - 2000000000;
+}
+
+static void* work(void *arg){
+    worker *w = (worker*)arg;
+    uint64_t state = 0x9e3779b97f4a7c15ull * (w->id + 1);
+    int64_t num;
+    record rec = {&num, sizeof(int64_t)};
+    if(w->phase == 3){
+        shard_key key = {0};
+        while(shardedRelaxedDeleteMin(w->Q, &key) >= 0)
+            w->popped++;
+        free(key.bytes);
+        return NULL;
+    }
+    if(w->phase == 2){
+        shard_key key = {0}, previous = {0};
+        w->ordered = YES;
+        long mult;
+        while((mult = shardedDeleteMin(w->Q, &key)) >= 0){
+            if(previous.present && keycmp(YES, &key, &previous) == -1)
+                w->ordered = NO;
+            previous = key;
+            w->popped++;
+        }
+        free(key.bytes);
+        return NULL;
+    }
+    for(size_t i=0; i<w->n; i++){
+        num = keyOf(&state);
+        if(w->phase == 0)
+            shardedInsert(w->Q, &rec);
+        else if(shardedLookup(w->Q, &rec) == 0){
+            fprintf(stderr, "llave %" PRId64 " no encontrada\n", num);
+            exit(1);
+        }
+    }
+    return NULL;
+}
+
+/*Corre una fase con "threads" hilos y regresa su duración*/
+static double phase(sharded_quash *Q, worker *w, pthread_t *tid, size_t threads, size_t n, int which){
+    for(size_t t=0; t<threads; t++){
+        w[t].Q = Q;
+        w[t].id = t;
+        w[t].n = n;
+        w[t].phase = which;
+        w[t].popped = 0;
+    }
+    double t0 = seconds();
+    for(size_t t=0; t<threads; t++)
+        pthread_create(&tid[t], NULL, work, &w[t]);
+    for(size_t t=0; t<threads; t++)
+        pthread_join(tid[t], NULL);
+    return seconds() - t0;
+}
+
+static void run(size_t shards, size_t threads, size_t n){
+    HTconfig cfg = {H_WY, YES, NO, DH, OUT_QUIET, NO, 0, 0, 0, HUGE_THP, ENGINE_HEAP};
+    sharded_quash *Q = newShardedQuash(shards, cfg);
+    worker *w = calloc(threads, sizeof(worker));
+    pthread_t *tid = malloc(sizeof(pthread_t)*threads);
+    double t_insert = phase(Q, w, tid, threads, n, 0);
+    double t_lookup = phase(Q, w, tid, threads, n, 1);
+    size_t distinct = shardedCount(Q);
+    double t_drain = phase(Q, w, tid, threads, n, 2);
+    size_t popped = 0;
+    for(size_t t=0; t<threads; t++){
+        popped += w[t].popped;
+        if(!w[t].ordered){
+            fprintf(stderr, "deleteMin fuera de orden en el hilo %zu\n", t);
+            exit(1);
+        }
+    }
+    if(popped != threads*n || shardedCount(Q) != 0){
+        fprintf(stderr, "se sacaron %zu de %zu\n", popped, threads*n);
+        exit(1);
+    }
+    //Se llena otra vez y se vacía con el deleteMin relajado
+    phase(Q, w, tid, threads, n, 0);
+    double t_relaxed = phase(Q, w, tid, threads, n, 3);
+    popped = 0;
+    for(size_t t=0; t<threads; t++)
+        popped += w[t].popped;
+    if(popped != threads*n || shardedCount(Q) != 0){
+        fprintf(stderr, "se sacaron %zu de %zu (relajado)\n", popped, threads*n);
+        exit(1);
+    }
+    printf("%7zu %7zu %9zu %9zu %12.2f %12.2f %12.2f %12.2f\n", threads, shards, threads*n, distinct,
+           threads*n/t_insert/1e6, threads*n/t_lookup/1e6, threads*n/t_drain/1e6, popped/t_relaxed/1e6);
+    free(tid);
+    free(w);
+    freeShardedQuash(Q);
+}
+
+/*Error de rango del deleteMin relajado con "shards" colas: se insertan las llaves 0..n-1 y, al sacar cada una, se
+ * cuenta cuántas menores seguían en el quash (con un árbol de Fenwick)*/
+static void rankError(size_t shards, size_t n){
+    HTconfig cfg = {H_WY, YES, NO, DH, OUT_QUIET, NO, 0, 0, 0, HUGE_THP, ENGINE_HEAP};
+    sharded_quash *Q = newShardedQuash(shards, cfg);
+    size_t *fenwick = calloc(n + 1, sizeof(size_t));
+    int64_t num;
+    record rec = {&num, sizeof(int64_t)};
+    for(num=0; num<(int64_t)n; num++){
+        shardedInsert(Q, &rec);
+        for(size_t i=num+1; i<=n; i+=i&-i)
+            fenwick[i]++;
+    }
+    shard_key key = {0};
+    size_t total = 0, max = 0;
+    while(shardedRelaxedDeleteMin(Q, &key) >= 0){
+        size_t rank = 0;
+        for(size_t i=key.num; i>0; i-=i&-i)
+            rank += fenwick[i];
+        for(size_t i=key.num+1; i<=n; i+=i&-i)
+            fenwick[i]--;
+        total += rank;
+        if(rank > max)
+            max = rank;
+    }
+    printf("%7zu %9zu %12.2f %9zu\n", shards, n, (double)total/n, max);
+    free(key.bytes);
+    free(fenwick);
+    freeShardedQuash(Q);
+}
+
+int main(int argc, char *argv[]){
+    size_t n = 200000;
+    size_t threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if(argc > 1)
+        n = strtoull(argv[1], NULL, 10);
+    if(argc > 2)
+        threads = strtoull(argv[2], NULL, 10);
+    char list[64];
+    snprintf(list, sizeof(list), "1,%zu,%zu", threads, 4*threads);
+    if(argc > 3)
+        snprintf(list, sizeof(list), "%s", argv[3]);
+    printf("%7s %7s %9s %9s %12s %12s %12s %12s\n", "threads", "shards", "ops", "distinct", "Mins/s", "Mlookups/s",
+           "Mdmin/s", "Mrelaxed/s");
+    size_t counts[16], k = 0;
+    for(char *item = strtok(list, ","); item != NULL && k < 16; item = strtok(NULL, ","))
+        counts[k++] = strtoull(item, NULL, 10);
+    for(size_t i=0; i<k; i++)
+        run(counts[i], threads, n);
+    printf("\n%7s %9s %12s %9s\n", "shards", "n", "avg_rank", "max_rank");
+    for(size_t i=0; i<k; i++)
+        rankError(counts[i], n);
+    return 0;
+}